@@ -0,0 +1,113 @@
+#include "capture_file.h"
+#include <chrono>
+#include <cstring>
+#include "../Utils/byte_order.h"
+
+uint64_t capture_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+CaptureWriter::~CaptureWriter() {
+    close();
+}
+
+bool CaptureWriter::open(const std::string& path, size_t buffer_size) {
+    close();
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) return false;
+
+    uint8_t header[CAPTURE_FILE_HEADER_SIZE] = {};
+    memcpy(header, CAPTURE_MAGIC, 8);
+    write_u32(header + 8, CAPTURE_VERSION);
+    file_.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file_.flush();
+
+    active_.assign(buffer_size, 0);
+    spare_.assign(buffer_size, 0);
+    active_used_ = 0;
+    written_ = 0;
+    dropped_ = 0;
+    stop_ = false;
+    running_ = true;
+    thread_ = std::thread(&CaptureWriter::flush_loop, this);
+    return file_.good();
+}
+
+bool CaptureWriter::append(uint64_t timestamp_ns, const struct sockaddr_in& source, const void* data, size_t length) {
+    if (length > CAPTURE_MAX_DATAGRAM) length = CAPTURE_MAX_DATAGRAM;
+    size_t size = CAPTURE_RECORD_HEADER_SIZE + length;
+    bool half_full;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_ || active_used_ + size > active_.size()) {
+            ++dropped_;
+            return false;
+        }
+        uint8_t* p = active_.data() + active_used_;
+        write_u64(p, timestamp_ns);
+        memcpy(p + 8, &source.sin_addr.s_addr, 4);
+        memcpy(p + 12, &source.sin_port, 2);
+        write_u16(p + 14, static_cast<uint16_t>(length));
+        memcpy(p + CAPTURE_RECORD_HEADER_SIZE, data, length);
+        active_used_ += size;
+        half_full = active_used_ * 2 >= active_.size();
+    }
+    ++written_;
+    // Будим поток записи только при заполнении наполовину, чтобы не платить за notify на каждый пакет
+    if (half_full) cv_.notify_one();
+    return true;
+}
+
+void CaptureWriter::flush_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait_for(lock, std::chrono::milliseconds(CAPTURE_FLUSH_MS),
+                     [&] { return stop_ || active_used_ * 2 >= active_.size(); });
+        size_t used = active_used_;
+        active_.swap(spare_);
+        active_used_ = 0;
+        bool stop = stop_;
+        lock.unlock();
+        if (used > 0) {
+            file_.write(reinterpret_cast<const char*>(spare_.data()), used);
+            file_.flush();
+        }
+        lock.lock();
+        if (stop && active_used_ == 0) break;
+    }
+}
+
+void CaptureWriter::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        stop_ = true;
+    }
+    cv_.notify_one();
+    thread_.join();
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_ = false;
+    file_.close();
+}
+
+bool CaptureReader::open(const std::string& path) {
+    file_.open(path, std::ios::binary);
+    if (!file_.is_open()) return false;
+    uint8_t header[CAPTURE_FILE_HEADER_SIZE];
+    if (!file_.read(reinterpret_cast<char*>(header), sizeof(header))) return false;
+    return memcmp(header, CAPTURE_MAGIC, 8) == 0 && read_u32(header + 8) == CAPTURE_VERSION;
+}
+
+bool CaptureReader::next(CaptureRecord& record) {
+    uint8_t header[CAPTURE_RECORD_HEADER_SIZE];
+    if (!file_.read(reinterpret_cast<char*>(header), sizeof(header))) return false;
+    record.timestamp_ns = read_u64(header);
+    memset(&record.source, 0, sizeof(record.source));
+    record.source.sin_family = AF_INET;
+    memcpy(&record.source.sin_addr.s_addr, header + 8, 4);
+    memcpy(&record.source.sin_port, header + 12, 2);
+    record.length = read_u16(header + 14);
+    record.data = data_;
+    return static_cast<bool>(file_.read(reinterpret_cast<char*>(data_), record.length));
+}
@@ -0,0 +1,75 @@
+#ifndef CAPTURE_FILE_H
+#define CAPTURE_FILE_H
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Файл захвата: заголовок "PGWCAPT1" + version(4) + reserved(4), затем записи
+// timestamp_ns(8) + ipv4(4) + port(2) + length(2) + датаграмма; целые — в сетевом порядке байт
+#define CAPTURE_MAGIC "PGWCAPT1"
+#define CAPTURE_VERSION 1
+#define CAPTURE_FILE_HEADER_SIZE 16
+#define CAPTURE_RECORD_HEADER_SIZE 16
+#define CAPTURE_MAX_DATAGRAM 65535
+#define CAPTURE_BUFFER_SIZE (1 << 20)
+#define CAPTURE_FLUSH_MS 100
+
+struct CaptureRecord {
+    uint64_t timestamp_ns; // CLOCK_MONOTONIC в момент приёма: важны только интервалы между записями
+    struct sockaddr_in source;
+    const uint8_t* data;   // действителен до следующего вызова CaptureReader::next
+    size_t length;
+};
+
+uint64_t capture_now_ns();
+
+// append копирует датаграмму в буфер в памяти; фоновый поток меняет буферы местами и пишет на диск.
+// Если диск не успевает и буфер полон, запись отбрасывается и учитывается в dropped().
+class CaptureWriter {
+public:
+    ~CaptureWriter();
+
+    bool open(const std::string& path, size_t buffer_size = CAPTURE_BUFFER_SIZE);
+    bool append(uint64_t timestamp_ns, const struct sockaddr_in& source, const void* data, size_t length);
+    void close();
+
+    bool is_open() const { return running_; }
+    uint64_t written() const { return written_; }
+    uint64_t dropped() const { return dropped_; }
+
+private:
+    void flush_loop();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<uint8_t> active_;
+    std::vector<uint8_t> spare_;
+    size_t active_used_ = 0;
+    std::ofstream file_;
+    std::thread thread_;
+    bool running_ = false;
+    bool stop_ = false;
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
+
+class CaptureReader {
+public:
+    bool open(const std::string& path);
+    // false в конце файла или на обрезанной записи
+    bool next(CaptureRecord& record);
+
+private:
+    std::ifstream file_;
+    uint8_t data_[CAPTURE_MAX_DATAGRAM];
+};
+
+#endif
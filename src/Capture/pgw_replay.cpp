@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+#include "capture_file.h"
+
+// Воспроизведение файла захвата против сервера с исходными интервалами между датаграммами.
+// Каждая датаграмма отправляется со свободного сокета из пула, поэтому ответ однозначно
+// сопоставляется с запросом и для старого формата без идентификаторов.
+
+#define REPLAY_SOCKETS 256
+#define REPLAY_TIMEOUT_MS 1000
+
+using replay_clock = std::chrono::steady_clock;
+
+struct InFlight {
+    bool busy = false;
+    replay_clock::time_point sent;
+};
+
+static void report(std::vector<double>& latencies_us, uint64_t sent, uint64_t lost, double total_sec,
+                   double max_lag_ms) {
+    std::cout << "Отправлено " << sent << ", получено ответов " << latencies_us.size() << ", потеряно " << lost
+              << " за " << total_sec << " с (" << sent / total_sec << " запр/с)" << std::endl;
+    std::cout << "Максимальное отставание от расписания: " << max_lag_ms << " мс" << std::endl;
+    if (latencies_us.empty()) return;
+    std::sort(latencies_us.begin(), latencies_us.end());
+    double sum = 0;
+    for (double l : latencies_us) sum += l;
+    auto pct = [&](double p) { return latencies_us[static_cast<size_t>(p * (latencies_us.size() - 1))]; };
+    std::cout << "Задержка: среднее " << sum / latencies_us.size() << " мкс, p50 " << pct(0.5) << " мкс, p90 "
+              << pct(0.9) << " мкс, p99 " << pct(0.99) << " мкс, p99.9 " << pct(0.999) << " мкс, max "
+              << latencies_us.back() << " мкс" << std::endl;
+}
+
+static int open_socket(const struct sockaddr_in& server_addr) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        std::cerr << "Ошибка создания UDP-сокета" << std::endl;
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int usage(const char* program) {
+    std::cerr << "Usage: " << program << " <capture.bin> <server_ip> <server_port> [speed|max] [timeout_ms]"
+              << std::endl;
+    return 1;
+}
+
+// Целое в [min, max] без лишних символов
+static bool parse_long(const char* text, long min, long max, long& value) {
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtol(text, &end, 10);
+    return errno == 0 && end != text && *end == '\0' && value >= min && value <= max;
+}
+
+static bool parse_speed(const char* text, double& speed) {
+    char* end = nullptr;
+    errno = 0;
+    speed = std::strtod(text, &end);
+    return errno == 0 && end != text && *end == '\0' && std::isfinite(speed) && speed > 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4 || argc > 6) return usage(argv[0]);
+    long port = 0;
+    if (!parse_long(argv[3], 1, 65535, port)) {
+        std::cerr << "Некорректный порт: " << argv[3] << std::endl;
+        return usage(argv[0]);
+    }
+    std::string speed_arg = argc > 4 ? argv[4] : "1";
+    bool max_speed = speed_arg == "max";
+    double speed = 0;
+    if (!max_speed && !parse_speed(speed_arg.c_str(), speed)) {
+        std::cerr << "Некорректная скорость: " << speed_arg << std::endl;
+        return usage(argv[0]);
+    }
+    long timeout_ms = REPLAY_TIMEOUT_MS;
+    if (argc > 5 && !parse_long(argv[5], 1, 3600 * 1000, timeout_ms)) {
+        std::cerr << "Некорректный тайм-аут: " << argv[5] << std::endl;
+        return usage(argv[0]);
+    }
+
+    CaptureReader reader;
+    if (!reader.open(argv[1])) {
+        std::cerr << "Не удалось открыть файл захвата: " << argv[1] << std::endl;
+        return 1;
+    }
+
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, argv[2], &server_addr.sin_addr) <= 0) {
+        std::cerr << "Неверный IP-адрес сервера: " << argv[2] << std::endl;
+        return 1;
+    }
+
+    std::vector<struct pollfd> fds(REPLAY_SOCKETS);
+    std::vector<InFlight> in_flight(REPLAY_SOCKETS);
+    std::vector<size_t> free_sockets;
+    for (size_t i = 0; i < REPLAY_SOCKETS; ++i) {
+        fds[i].fd = open_socket(server_addr);
+        fds[i].events = POLLIN;
+        if (fds[i].fd < 0) return 1;
+        free_sockets.push_back(REPLAY_SOCKETS - 1 - i);
+    }
+
+    std::vector<double> latencies;
+    uint64_t sent = 0, lost = 0;
+    double max_lag_ms = 0;
+    char buffer[CAPTURE_MAX_DATAGRAM];
+    auto timeout = std::chrono::milliseconds(timeout_ms);
+
+    CaptureRecord record;
+    bool have_record = reader.next(record);
+    uint64_t first_ns = have_record ? record.timestamp_ns : 0;
+    auto start = replay_clock::now();
+
+    while (have_record || free_sockets.size() < REPLAY_SOCKETS) {
+        auto now = replay_clock::now();
+        for (size_t i = 0; i < REPLAY_SOCKETS; ++i) {
+            if (in_flight[i].busy && now - in_flight[i].sent > timeout) {
+                // Сокет пересоздаётся, чтобы опоздавший ответ не засчитался следующему запросу
+                close(fds[i].fd);
+                fds[i].fd = open_socket(server_addr);
+                if (fds[i].fd < 0) return 1;
+                in_flight[i].busy = false;
+                free_sockets.push_back(i);
+                ++lost;
+            }
+        }
+
+        auto due = start;
+        if (have_record && !max_speed) {
+            // Время в захвате не убывает, но старые файлы писались по системным часам, которые могли отступить
+            uint64_t offset_ns = record.timestamp_ns > first_ns ? record.timestamp_ns - first_ns : 0;
+            due += std::chrono::duration_cast<replay_clock::duration>(
+                std::chrono::duration<double, std::nano>(offset_ns / speed));
+        }
+        if (have_record && now >= due && !free_sockets.empty()) {
+            size_t i = free_sockets.back();
+            free_sockets.pop_back();
+            if (!max_speed) {
+                max_lag_ms = std::max(max_lag_ms, std::chrono::duration<double, std::milli>(now - due).count());
+            }
+            in_flight[i].busy = true;
+            in_flight[i].sent = replay_clock::now();
+            send(fds[i].fd, record.data, record.length, 0);
+            ++sent;
+            have_record = reader.next(record);
+            continue;
+        }
+
+        // Спим до следующей отправки или до ответа, но не дольше тайм-аута ожидания
+        auto wait = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout);
+        if (have_record && !free_sockets.empty()) {
+            wait = std::min(wait, std::chrono::duration_cast<std::chrono::nanoseconds>(due - now));
+        }
+        struct timespec ts;
+        ts.tv_sec = wait.count() / 1000000000;
+        ts.tv_nsec = wait.count() % 1000000000;
+        if (ppoll(fds.data(), fds.size(), &ts, nullptr) <= 0) continue;
+
+        now = replay_clock::now();
+        for (size_t i = 0; i < REPLAY_SOCKETS; ++i) {
+            if (!(fds[i].revents & POLLIN)) continue;
+            ssize_t n = recv(fds[i].fd, buffer, sizeof(buffer), 0);
+            if (n < 0 || !in_flight[i].busy) continue;
+            latencies.push_back(std::chrono::duration<double, std::micro>(now - in_flight[i].sent).count());
+            in_flight[i].busy = false;
+            free_sockets.push_back(i);
+        }
+    }
+
+    report(latencies, sent, lost, std::chrono::duration<double>(replay_clock::now() - start).count(), max_lag_ms);
+    for (const auto& fd : fds) close(fd.fd);
+    return 0;
+}
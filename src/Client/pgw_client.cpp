@@ -1,27 +1,22 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <cstring>
-#include <sys/socket.h>
-#include <arpa/inet.h>
-#include <unistd.h>
-#include <fcntl.h>
-#include <sys/select.h>
+#include <vector>
 #include "../Utils/utils.h"
 #include "../Configs/pgw_client_config.h"
+#include "pgw_client_lib.h"
 #include "nlohmann/json.hpp"
 #include "spdlog/spdlog.h"
 #include "spdlog/sinks/basic_file_sink.h"
 
-#define BUFFER_SIZE 1024
-
 int main(int argc, char* argv[]) {
-    if (argc != 3) {
-        std::cerr << "Usage: " << argv[0] << " <config.json> <IMSI>" << std::endl;
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <config.json> <IMSI> [IMSI...]" << std::endl;
         return 1;
     }
     std::string config_file = argv[1];
     std::string imsi = argv[2];
+    std::vector<std::string> imsis(argv + 2, argv + argc);
 
     auto config = load_pgw_client_config(config_file);
     if (!validate_pgw_client_config(config)) {
@@ -43,71 +38,53 @@ int main(int argc, char* argv[]) {
     logger->flush_on(spdlog::level::info);
     logger->info("Клиент запущен с IMSI: {}", imsi);
 
-    std::vector<uint8_t> bcd_imsi = encode_bcd(imsi);
-    logger->info("IMSI закодирован в BCD, длина: {}", bcd_imsi.size());
-
-    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sockfd < 0) {
-        logger->error("Ошибка создания сокета: {}", strerror(errno));
-        std::cerr << "Ошибка создания сокета" << std::endl;
-        return 1;
+    for (const auto& value : imsis) {
+        if (imsi_key_from_string(value) == IMSI_KEY_INVALID) {
+            logger->error("Некорректный IMSI: {}", value);
+            std::cerr << "Некорректный IMSI: " << value << std::endl;
+            return 1;
+        }
     }
 
-    int flags = fcntl(sockfd, F_GETFL, 0);
-    fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
+    // По умолчанию четыре попытки по секунде с паузами 100, 200 и 400 мс — около пяти секунд, как раньше у select.
+    // Сервер не отличает повтор от нового запроса: если потерялся ответ, в CDR появится лишняя запись created
+    PgwClientOptions options;
+    options.server_ip = config.server_ip;
+    options.server_port = config.server_port;
+    options.timeout = std::chrono::milliseconds(1000);
+    options.max_retries = config.max_retries;
+    options.retry_backoff = std::chrono::milliseconds(100);
 
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    if (inet_pton(AF_INET, config.server_ip.c_str(), &server_addr.sin_addr) <= 0) {
-        logger->error("Неверный IP-адрес сервера: {}", config.server_ip);
-        std::cerr << "Неверный IP-адрес сервера" << std::endl;
-        close(sockfd);
+    PgwClient client;
+    if (!client.connect(options, logger)) {
+        std::cerr << "Ошибка создания сокета" << std::endl;
         return 1;
     }
-    server_addr.sin_port = htons(config.server_port);
 
-    logger->info("Отправка BCD-IMSI на {}:{}", config.server_ip, config.server_port);
-    if (sendto(sockfd, bcd_imsi.data(), bcd_imsi.size(), 0, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        logger->error("Ошибка отправки пакета: {}", strerror(errno));
-        std::cerr << "Ошибка отправки пакета" << std::endl;
-        close(sockfd);
-        return 1;
+    logger->info("Отправка {} IMSI на {}:{}", imsis.size(), config.server_ip, config.server_port);
+    std::vector<std::future<PgwResult>> results;
+    for (const auto& value : imsis) {
+        results.push_back(client.request(value));
     }
 
-    char buffer[BUFFER_SIZE];
-    struct sockaddr_in recv_addr;
-    socklen_t addr_len = sizeof(recv_addr);
-    fd_set read_fds;
-    FD_ZERO(&read_fds);
-    FD_SET(sockfd, &read_fds);
-    struct timeval tv = {5, 0};
-    int ret = select(sockfd + 1, &read_fds, nullptr, nullptr, &tv);
-    if (ret < 0) {
-        logger->error("Ошибка select: {}", strerror(errno));
-        std::cerr << "Ошибка select" << std::endl;
-        close(sockfd);
-        return 1;
-    }
-    if (ret == 0) {
-        logger->error("Таймаут получения ответа");
-        std::cerr << "Таймаут получения ответа" << std::endl;
-        close(sockfd);
-        return 1;
-    }
-    if (FD_ISSET(sockfd, &read_fds)) {
-        int bytes_received = recvfrom(sockfd, buffer, BUFFER_SIZE - 1, 0, (struct sockaddr*)&recv_addr, &addr_len);
-        if (bytes_received < 0) {
-            logger->error("Ошибка получения ответа: {}", strerror(errno));
-            std::cerr << "Ошибка получения ответа" << std::endl;
+    int exit_code = 0;
+    for (size_t i = 0; i < imsis.size(); ++i) {
+        PgwResult result = results[i].get();
+        if (result == PGW_RESULT_TIMEOUT || result == PGW_RESULT_ERROR) {
+            logger->error("Таймаут получения ответа для IMSI {}", imsis[i]);
+            std::cerr << "Таймаут получения ответа" << std::endl;
+            exit_code = 1;
+            continue;
+        }
+        logger->info("Получен ответ для IMSI {}: {}", imsis[i], pgw_result_name(result));
+        if (imsis.size() > 1) {
+            std::cout << "Ответ от сервера: " << imsis[i] << " " << pgw_result_name(result) << std::endl;
         } else {
-            buffer[bytes_received] = '\0';
-            logger->info("Получен ответ: {}", buffer);
-            std::cout << "Ответ от сервера: " << buffer << std::endl;
+            std::cout << "Ответ от сервера: " << pgw_result_name(result) << std::endl;
         }
     }
 
-    close(sockfd);
+    client.close();
     logger->flush();
-    return 0;
-}
\ No newline at end of file
+    return exit_code;
+}
@@ -0,0 +1,290 @@
+#include "pgw_client_lib.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "../Utils/utils.h"
+#include "../Utils/batch_protocol.h"
+#include "spdlog/sinks/null_sink.h"
+
+#define CLIENT_POLL_MAX_MS 100
+
+const char* pgw_result_name(PgwResult result) {
+    switch (result) {
+        case PGW_RESULT_CREATED: return "created";
+        case PGW_RESULT_REJECTED: return "rejected";
+        case PGW_RESULT_INVALID: return "invalid";
+        case PGW_RESULT_TIMEOUT: return "timeout";
+        default: return "error";
+    }
+}
+
+PgwClient::~PgwClient() {
+    close();
+}
+
+bool PgwClient::connect(const PgwClientOptions& options, std::shared_ptr<spdlog::logger> logger) {
+    close();
+    options_ = options;
+    if (options_.max_batch == 0 || options_.max_batch > BATCH_MAX_ENTRIES) options_.max_batch = BATCH_MAX_ENTRIES;
+    logger_ = std::move(logger);
+    if (!logger_) logger_ = std::make_shared<spdlog::logger>("pgw_client", std::make_shared<spdlog::sinks::null_sink_mt>());
+
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(options_.server_port);
+    if (inet_pton(AF_INET, options_.server_ip.c_str(), &server_addr.sin_addr) <= 0) {
+        logger_->error("Неверный IP-адрес сервера: {}", options_.server_ip);
+        return false;
+    }
+    sockfd_ = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (sockfd_ < 0 || ::connect(sockfd_, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        logger_->error("Ошибка создания сокета: {}", strerror(errno));
+        close();
+        return false;
+    }
+    wakefd_ = eventfd(0, EFD_NONBLOCK);
+    if (wakefd_ < 0) {
+        logger_->error("Ошибка создания eventfd: {}", strerror(errno));
+        close();
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = false;
+    }
+    stop_ = false;
+    thread_ = std::thread(&PgwClient::io_loop, this);
+    logger_->info("Клиент подключён к {}:{}", options_.server_ip, options_.server_port);
+    return true;
+}
+
+void PgwClient::close() {
+    stop_ = true;
+    if (thread_.joinable()) {
+        wake();
+        thread_.join();
+    }
+    if (sockfd_ >= 0) ::close(sockfd_);
+    if (wakefd_ >= 0) ::close(wakefd_);
+    sockfd_ = -1;
+    wakefd_ = -1;
+}
+
+void PgwClient::wake() {
+    uint64_t one = 1;
+    if (write(wakefd_, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        logger_->error("Ошибка записи в eventfd: {}", strerror(errno));
+    }
+}
+
+void PgwClient::request(uint64_t imsi_key, PgwCallback callback, std::chrono::milliseconds timeout) {
+    if (imsi_key == IMSI_KEY_INVALID) {
+        callback(PGW_RESULT_INVALID);
+        return;
+    }
+    Pending pending{next_request_id_.fetch_add(1) + 1, imsi_key, timeout.count() > 0 ? timeout : options_.timeout,
+                    1, 0, std::move(callback)};
+    bool was_empty = false;
+    bool accepted = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!closed_) {
+            was_empty = submitted_.empty();
+            submitted_.push_back(std::move(pending));
+            ++in_flight_count_;
+            accepted = true;
+        }
+    }
+    if (!accepted) {
+        pending.callback(PGW_RESULT_ERROR);
+        return;
+    }
+    // Поток ввода-вывода забирает всю очередь за раз, поэтому будить его нужно только для первого запроса
+    if (was_empty) wake();
+}
+
+void PgwClient::request(const std::string& imsi, PgwCallback callback, std::chrono::milliseconds timeout) {
+    request(imsi_key_from_string(imsi), std::move(callback), timeout);
+}
+
+std::future<PgwResult> PgwClient::request(uint64_t imsi_key, std::chrono::milliseconds timeout) {
+    auto promise = std::make_shared<std::promise<PgwResult>>();
+    std::future<PgwResult> future = promise->get_future();
+    request(imsi_key, [promise](PgwResult result) { promise->set_value(result); }, timeout);
+    return future;
+}
+
+std::future<PgwResult> PgwClient::request(const std::string& imsi, std::chrono::milliseconds timeout) {
+    return request(imsi_key_from_string(imsi), timeout);
+}
+
+void PgwClient::io_loop() {
+    std::vector<Pending> ready;
+    struct pollfd fds[2];
+    fds[0].fd = sockfd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = wakefd_;
+    fds[1].events = POLLIN;
+
+    while (!stop_) {
+        auto now = clock::now();
+        while (!delayed_.empty() && delayed_.begin()->first <= now) {
+            ready.push_back(std::move(delayed_.begin()->second));
+            delayed_.erase(delayed_.begin());
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            while (!submitted_.empty()) {
+                ready.push_back(std::move(submitted_.front()));
+                submitted_.pop_front();
+            }
+        }
+        if (!ready.empty()) send_ready(ready);
+        expire(now);
+
+        auto wait = std::chrono::milliseconds(CLIENT_POLL_MAX_MS);
+        if (!deadlines_.empty()) {
+            wait = std::min(wait, std::chrono::ceil<std::chrono::milliseconds>(deadlines_.top().at - now));
+        }
+        if (!delayed_.empty()) {
+            wait = std::min(wait, std::chrono::ceil<std::chrono::milliseconds>(delayed_.begin()->first - now));
+        }
+        if (poll(fds, 2, std::max<int64_t>(wait.count(), 0)) <= 0) continue;
+        if (fds[1].revents & POLLIN) {
+            uint64_t value;
+            while (read(wakefd_, &value, sizeof(value)) > 0) {}
+        }
+        if (fds[0].revents & POLLIN) receive();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        while (!submitted_.empty()) {
+            ready.push_back(std::move(submitted_.front()));
+            submitted_.pop_front();
+        }
+    }
+    for (auto& pending : ready) finish(pending, PGW_RESULT_ERROR);
+    for (auto& entry : delayed_) finish(entry.second, PGW_RESULT_ERROR);
+    for (auto& entry : sent_) finish(entry.second, PGW_RESULT_ERROR);
+    delayed_.clear();
+    sent_.clear();
+    batches_.clear();
+    deadlines_ = {};
+}
+
+void PgwClient::send_ready(std::vector<Pending>& ready) {
+    uint8_t payload[BATCH_MAX_REQUEST_SIZE];
+    uint32_t request_ids[BATCH_MAX_ENTRIES];
+    uint64_t keys[BATCH_MAX_ENTRIES];
+    auto now = clock::now();
+
+    for (size_t begin = 0; begin < ready.size(); begin += options_.max_batch) {
+        size_t count = std::min(options_.max_batch, ready.size() - begin);
+        uint32_t batch_id = ++next_batch_id_;
+        std::vector<uint32_t>& batch = batches_[batch_id];
+        for (size_t i = 0; i < count; ++i) {
+            Pending& pending = ready[begin + i];
+            request_ids[i] = pending.request_id;
+            keys[i] = pending.imsi_key;
+            pending.batch_id = batch_id;
+            batch.push_back(pending.request_id);
+            deadlines_.push({now + pending.timeout, pending.request_id, batch_id});
+            sent_.emplace(pending.request_id, std::move(pending));
+        }
+        size_t len = encode_batch_request(batch_id, request_ids, keys, count, payload, sizeof(payload));
+        // Ошибку отправки не обрабатываем отдельно: запросы повторятся по тайм-ауту
+        if (send(sockfd_, payload, len, 0) < 0) {
+            logger_->warn("Ошибка отправки пакетного запроса {}: {}", batch_id, strerror(errno));
+        } else {
+            logger_->debug("Пакетный запрос {} из {} IMSI отправлен", batch_id, count);
+        }
+    }
+    ready.clear();
+}
+
+void PgwClient::receive() {
+    uint8_t buffer[BATCH_MAX_RESPONSE_SIZE];
+    while (true) {
+        ssize_t n = recv(sockfd_, buffer, sizeof(buffer), 0);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            // ICMP port unreachable на подключённом сокете: сервер ещё не запущен, запросы повторятся
+            if (errno == ECONNREFUSED) continue;
+            logger_->error("Ошибка получения ответа: {}", strerror(errno));
+            return;
+        }
+        uint32_t batch_id = 0;
+        const uint8_t* statuses = nullptr;
+        size_t count = 0;
+        BatchParseResult result = parse_batch_response(buffer, n, batch_id, statuses, count);
+        if (result != BATCH_PARSE_OK) {
+            logger_->warn("Некорректный пакетный ответ: {}", batch_parse_error(result));
+            continue;
+        }
+        auto batch = batches_.find(batch_id);
+        if (batch == batches_.end()) continue; // ответ на уже повторённый запрос
+        if (batch->second.size() != count) {
+            logger_->warn("Ответ на пакетный запрос {}: {} статусов вместо {}", batch_id, count, batch->second.size());
+            continue;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            auto it = sent_.find(batch->second[i]);
+            if (it == sent_.end() || it->second.batch_id != batch_id) continue;
+            finish(it->second, static_cast<PgwResult>(statuses[i]));
+            sent_.erase(it);
+        }
+        batches_.erase(batch);
+    }
+}
+
+void PgwClient::expire(clock::time_point now) {
+    while (!deadlines_.empty() && deadlines_.top().at <= now) {
+        Deadline deadline = deadlines_.top();
+        deadlines_.pop();
+        auto it = sent_.find(deadline.request_id);
+        if (it == sent_.end() || it->second.batch_id != deadline.batch_id) continue;
+        Pending pending = std::move(it->second);
+        sent_.erase(it);
+
+        // Пакет забываем, когда в нём не осталось ожидающих запросов
+        auto batch = batches_.find(deadline.batch_id);
+        if (batch != batches_.end()) {
+            bool outstanding = false;
+            for (uint32_t request_id : batch->second) {
+                auto other = sent_.find(request_id);
+                if (other != sent_.end() && other->second.batch_id == deadline.batch_id) {
+                    outstanding = true;
+                    break;
+                }
+            }
+            if (!outstanding) batches_.erase(batch);
+        }
+
+        char digits[IMSI_MAX_DIGITS + 1];
+        imsi_key_to_digits(pending.imsi_key, digits);
+        if (pending.attempt <= options_.max_retries) {
+            auto backoff = options_.retry_backoff * (1u << std::min<uint32_t>(pending.attempt - 1, 16));
+            logger_->debug("Нет ответа для IMSI {}, повтор {} через {} мс", digits, pending.attempt, backoff.count());
+            ++pending.attempt;
+            ++retries_;
+            delayed_.emplace(now + backoff, std::move(pending));
+        } else {
+            logger_->warn("Нет ответа для IMSI {} после {} попыток", digits, pending.attempt);
+            finish(pending, PGW_RESULT_TIMEOUT);
+        }
+    }
+}
+
+void PgwClient::finish(Pending& pending, PgwResult result) {
+    --in_flight_count_;
+    if (pending.callback) pending.callback(result);
+}
@@ -0,0 +1,112 @@
+#ifndef PGW_CLIENT_LIB_H
+#define PGW_CLIENT_LIB_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "spdlog/spdlog.h"
+
+// Итог запроса: первые три значения совпадают с BatchStatus сервера
+enum PgwResult : uint8_t {
+    PGW_RESULT_CREATED = 0,
+    PGW_RESULT_REJECTED = 1,
+    PGW_RESULT_INVALID = 2,
+    PGW_RESULT_TIMEOUT = 3, // ответа нет после всех повторов
+    PGW_RESULT_ERROR = 4,   // клиент закрыт до получения ответа
+};
+
+const char* pgw_result_name(PgwResult result);
+
+using PgwCallback = std::function<void(PgwResult)>;
+
+struct PgwClientOptions {
+    std::string server_ip = "127.0.0.1";
+    uint32_t server_port = 9000;
+    std::chrono::milliseconds timeout{1000};       // на одну попытку, если не задан в запросе
+    uint32_t max_retries = 3;                      // повтор после потерянного ответа дублирует CDR created
+    std::chrono::milliseconds retry_backoff{100};  // удваивается с каждой попыткой
+    size_t max_batch = 256;                        // не больше BATCH_MAX_ENTRIES
+};
+
+// Асинхронный клиент PGW поверх одного UDP-сокета. Запросы, накопившиеся к моменту отправки,
+// уходят одним пакетным запросом; ответы сопоставляются по batch_id и request_id.
+// Обратные вызовы выполняются в потоке ввода-вывода клиента и не должны блокироваться.
+class PgwClient {
+public:
+    PgwClient() = default;
+    ~PgwClient();
+    PgwClient(const PgwClient&) = delete;
+    PgwClient& operator=(const PgwClient&) = delete;
+
+    bool connect(const PgwClientOptions& options, std::shared_ptr<spdlog::logger> logger = nullptr);
+    // Завершает все незавершённые запросы с PGW_RESULT_ERROR
+    void close();
+
+    void request(uint64_t imsi_key, PgwCallback callback, std::chrono::milliseconds timeout = {});
+    void request(const std::string& imsi, PgwCallback callback, std::chrono::milliseconds timeout = {});
+    std::future<PgwResult> request(uint64_t imsi_key, std::chrono::milliseconds timeout = {});
+    std::future<PgwResult> request(const std::string& imsi, std::chrono::milliseconds timeout = {});
+
+    size_t in_flight() const { return in_flight_count_; }
+    uint64_t retries() const { return retries_; }
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct Pending {
+        uint32_t request_id;
+        uint64_t imsi_key;
+        std::chrono::milliseconds timeout;
+        uint32_t attempt;
+        uint32_t batch_id;
+        PgwCallback callback;
+    };
+
+    struct Deadline {
+        clock::time_point at;
+        uint32_t request_id;
+        uint32_t batch_id;
+        bool operator>(const Deadline& other) const { return at > other.at; }
+    };
+
+    void io_loop();
+    void send_ready(std::vector<Pending>& ready);
+    void receive();
+    void expire(clock::time_point now);
+    void finish(Pending& pending, PgwResult result);
+    void wake();
+
+    PgwClientOptions options_;
+    std::shared_ptr<spdlog::logger> logger_;
+    int sockfd_ = -1;
+    int wakefd_ = -1;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<size_t> in_flight_count_{0};
+    std::atomic<uint64_t> retries_{0};
+    std::atomic<uint32_t> next_request_id_{0};
+
+    std::mutex mutex_;
+    std::deque<Pending> submitted_;
+    bool closed_ = true;
+
+    // Состояние ниже принадлежит потоку ввода-вывода
+    uint32_t next_batch_id_ = 0;
+    std::unordered_map<uint32_t, Pending> sent_;                  // request_id -> запрос
+    std::unordered_map<uint32_t, std::vector<uint32_t>> batches_; // batch_id -> request_id по порядку
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> deadlines_;
+    std::multimap<clock::time_point, Pending> delayed_;           // повторы, ждущие паузы
+};
+
+#endif
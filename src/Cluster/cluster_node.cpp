@@ -0,0 +1,480 @@
+#include "cluster_node.h"
+#include <algorithm>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "cluster_protocol.h"
+#include "../Utils/batch_protocol.h"
+#include "../Utils/utils.h"
+#include "spdlog/sinks/null_sink.h"
+
+ClusterNode::ClusterNode(const pgw_server_config& config, PgwEngine& engine, std::shared_ptr<spdlog::logger> logger)
+    : config_(config), engine_(engine), logger_(std::move(logger)) {
+    if (!logger_) logger_ = std::make_shared<spdlog::logger>("pgw_cluster", std::make_shared<spdlog::sinks::null_sink_mt>());
+    for (size_t i = 0; i < config_.cluster_nodes.size(); ++i) {
+        const auto& node = config_.cluster_nodes[i];
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(node.port);
+        inet_pton(AF_INET, node.ip.c_str(), &addr.sin_addr);
+        ids_.push_back(node.id);
+        addrs_.push_back(addr);
+        if (node.id == config_.cluster_node_id) self_ = static_cast<int>(i);
+    }
+    // Пока соседи не прислали heartbeat, узел считает живым только себя
+    alive_.assign(ids_.size(), false);
+    last_seen_.assign(ids_.size(), std::chrono::steady_clock::time_point());
+    if (self_ >= 0) alive_[self_] = true;
+    ring_.build(ids_, alive_, config_.cluster_virtual_nodes);
+}
+
+ClusterNode::~ClusterNode() {
+    stop();
+}
+
+bool ClusterNode::start(int client_sockfd, ForwardHandler handler) {
+    if (self_ < 0) return false;
+    sockfd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd_ < 0) return false;
+    struct timeval tv = {0, CLUSTER_TICK_MS * 1000};
+    setsockopt(sockfd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    if (bind(sockfd_, (struct sockaddr*)&addrs_[self_], sizeof(addrs_[self_])) < 0) {
+        logger_->error("Ошибка привязки межузлового сокета к порту {}", config_.cluster_nodes[self_].port);
+        close(sockfd_);
+        sockfd_ = -1;
+        return false;
+    }
+    std::vector<SessionRecord> existing;
+    engine_.snapshot_sessions(existing);
+    for (const auto& record : existing) owned_[record.imsi_key] = record.start_time;
+    client_sockfd_ = client_sockfd;
+    handler_ = std::move(handler);
+    running_ = true;
+    thread_ = std::thread(&ClusterNode::run, this);
+    logger_->info("Узел кластера {} запущен, узлов в конфиге: {}", ids_[self_], ids_.size());
+    return true;
+}
+
+void ClusterNode::stop() {
+    running_ = false;
+    if (thread_.joinable()) thread_.join();
+    if (sockfd_ >= 0) {
+        close(sockfd_);
+        sockfd_ = -1;
+    }
+}
+
+int ClusterNode::owner_of(uint64_t imsi_key) {
+    std::shared_lock<std::shared_mutex> lock(ring_mutex_);
+    return ring_.owner(imsi_key);
+}
+
+bool ClusterNode::is_alive(int node) {
+    std::shared_lock<std::shared_mutex> lock(ring_mutex_);
+    return node >= 0 && node < static_cast<int>(alive_.size()) && alive_[node];
+}
+
+size_t ClusterNode::replica_count() {
+    std::lock_guard<std::mutex> lock(replica_mutex_);
+    return replicas_.size();
+}
+
+size_t ClusterNode::handoffs_in_flight() {
+    std::lock_guard<std::mutex> lock(handoff_mutex_);
+    return handoffs_.size();
+}
+
+bool ClusterNode::route(const uint8_t* data, size_t len, const struct sockaddr_in& client) {
+    int owner = -1;
+    {
+        std::shared_lock<std::shared_mutex> lock(ring_mutex_);
+        if (is_batch_datagram(data, len)) {
+            // Пакет пересылается целиком, только если все IMSI принадлежат одному чужому узлу;
+            // иначе он обрабатывается здесь, а чужие сессии затем передаются владельцам.
+            BatchRequestView view;
+            if (view.parse(data, len) != BATCH_PARSE_OK) return false;
+            for (size_t i = 0; i < view.count(); ++i) {
+                uint64_t key = imsi_key_from_bcd(view.bcd(i), IMSI_BCD_MAX_BYTES);
+                if (key == IMSI_KEY_INVALID) continue;
+                int entry_owner = ring_.owner(key);
+                if (owner >= 0 && entry_owner != owner) return false;
+                owner = entry_owner;
+            }
+        } else {
+            uint64_t key = imsi_key_from_bcd(data, len);
+            if (key == IMSI_KEY_INVALID) return false;
+            owner = ring_.owner(key);
+        }
+    }
+    if (owner < 0 || owner == self_) return false;
+
+    uint8_t message[CLUSTER_MAX_MESSAGE];
+    size_t size = encode_cluster_forward(CLUSTER_FORWARD, self_, client, data, len, message, sizeof(message));
+    if (size == 0) return false;
+    send_to(owner, message, size);
+    return true;
+}
+
+void ClusterNode::reply(int sender, const struct sockaddr_in& client, const uint8_t* response, size_t len) {
+    if (sender < 0 || sender >= static_cast<int>(addrs_.size()) || len == 0) return;
+    uint8_t message[CLUSTER_MAX_MESSAGE];
+    size_t size = encode_cluster_forward(CLUSTER_FORWARD_REPLY, self_, client, response, len, message, sizeof(message));
+    if (size > 0) send_to(sender, message, size);
+}
+
+void ClusterNode::on_session_created(uint64_t imsi_key, time_t start_time) {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    pending_.push_back({imsi_key, start_time, true});
+}
+
+void ClusterNode::on_session_removed(uint64_t imsi_key) {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    pending_.push_back({imsi_key, 0, false});
+}
+
+void ClusterNode::send_to(int node, const uint8_t* data, size_t len) {
+    sendto(sockfd_, data, len, 0, (const struct sockaddr*)&addrs_[node], sizeof(addrs_[node]));
+}
+
+void ClusterNode::send_records(int node, uint8_t type, const std::vector<SessionRecord>& records) {
+    uint8_t message[CLUSTER_MAX_MESSAGE];
+    for (size_t offset = 0; offset < records.size(); offset += CLUSTER_MAX_RECORDS) {
+        size_t count = std::min(records.size() - offset, static_cast<size_t>(CLUSTER_MAX_RECORDS));
+        size_t size = encode_cluster_records(type, self_, records.data() + offset, count, message, sizeof(message));
+        if (size > 0) send_to(node, message, size);
+    }
+}
+
+void ClusterNode::send_grouped(uint8_t type, const std::map<int, std::vector<SessionRecord>>& groups) {
+    for (const auto& group : groups) {
+        send_records(group.first, type, group.second);
+    }
+}
+
+void ClusterNode::run() {
+    uint8_t buffer[CLUSTER_MAX_MESSAGE];
+    uint8_t heartbeat[CLUSTER_HEADER_SIZE];
+    size_t heartbeat_len = encode_cluster_heartbeat(self_, heartbeat, sizeof(heartbeat));
+    auto last_heartbeat = std::chrono::steady_clock::time_point();
+    auto last_purge = std::chrono::steady_clock::now();
+
+    while (running_) {
+        ssize_t received = recv(sockfd_, buffer, sizeof(buffer), 0);
+        if (received > 0) handle_message(buffer, received);
+
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_heartbeat >= std::chrono::milliseconds(config_.cluster_heartbeat_ms)) {
+            for (size_t node = 0; node < addrs_.size(); ++node) {
+                if (static_cast<int>(node) != self_) send_to(node, heartbeat, heartbeat_len);
+            }
+            last_heartbeat = now;
+        }
+        check_failures(now);
+        flush_pending();
+        retry_handoffs(now);
+        if (now - last_purge >= std::chrono::seconds(1)) {
+            purge_replicas();
+            last_purge = now;
+        }
+    }
+    logger_->info("Поток узла кластера завершён");
+}
+
+void ClusterNode::handle_message(const uint8_t* data, size_t len) {
+    ClusterMessage message;
+    if (!parse_cluster_message(data, len, message) || message.sender >= ids_.size() ||
+        message.sender == self_) {
+        logger_->warn("Некорректное межузловое сообщение длиной {}", len);
+        return;
+    }
+    mark_alive(message.sender);
+
+    switch (message.type) {
+        case CLUSTER_HEARTBEAT:
+            break;
+        case CLUSTER_FORWARD:
+            // Обработка уходит рабочим потокам: всплеск пересланных запросов не должен задерживать heartbeat
+            if (!handler_(message.payload, message.payload_len, message.client, message.sender)) {
+                logger_->warn("Очереди рабочих потоков переполнены, пересланный запрос от {} отброшен",
+                              ids_[message.sender]);
+            }
+            break;
+        case CLUSTER_FORWARD_REPLY:
+            sendto(client_sockfd_, message.payload, message.payload_len, 0,
+                   (const struct sockaddr*)&message.client, sizeof(message.client));
+            break;
+        case CLUSTER_REPLICATE: {
+            std::lock_guard<std::mutex> lock(replica_mutex_);
+            for (size_t i = 0; i < message.count; ++i) {
+                SessionRecord record = message.record(i);
+                replicas_[record.imsi_key] = {record.start_time, message.sender};
+            }
+            break;
+        }
+        case CLUSTER_EXPIRE: {
+            std::lock_guard<std::mutex> lock(replica_mutex_);
+            for (size_t i = 0; i < message.count; ++i) {
+                replicas_.erase(message.record(i).imsi_key);
+            }
+            break;
+        }
+        case CLUSTER_HANDOFF: {
+            std::vector<SessionRecord> records;
+            for (size_t i = 0; i < message.count; ++i) {
+                records.push_back(message.record(i));
+            }
+            {
+                std::lock_guard<std::mutex> lock(replica_mutex_);
+                for (const auto& record : records) replicas_.erase(record.imsi_key);
+            }
+            size_t adopted = engine_.adopt_sessions(records);
+            // Подтверждаем и повторный HANDOFF, если потерялось прежнее подтверждение
+            send_records(message.sender, CLUSTER_HANDOFF_ACK, records);
+            logger_->info("Принято {} сессий от узла {}", adopted, ids_[message.sender]);
+            break;
+        }
+        case CLUSTER_HANDOFF_ACK: {
+            std::lock_guard<std::mutex> lock(handoff_mutex_);
+            for (size_t i = 0; i < message.count; ++i) {
+                auto it = handoffs_.find(message.record(i).imsi_key);
+                if (it != handoffs_.end() && it->second.owner == message.sender) handoffs_.erase(it);
+            }
+            break;
+        }
+    }
+}
+
+void ClusterNode::mark_alive(int node) {
+    last_seen_[node] = std::chrono::steady_clock::now();
+    {
+        std::shared_lock<std::shared_mutex> lock(ring_mutex_);
+        if (alive_[node]) return;
+    }
+    HashRing previous;
+    {
+        std::unique_lock<std::shared_mutex> lock(ring_mutex_);
+        alive_[node] = true;
+        previous = ring_;
+        ring_.build(ids_, alive_, config_.cluster_virtual_nodes);
+    }
+    logger_->info("Узел кластера {} доступен", ids_[node]);
+    membership_changed(-1, previous);
+}
+
+void ClusterNode::check_failures(std::chrono::steady_clock::time_point now) {
+    for (size_t node = 0; node < ids_.size(); ++node) {
+        if (static_cast<int>(node) == self_ || !is_alive(node)) continue;
+        if (now - last_seen_[node] < std::chrono::milliseconds(config_.cluster_failure_timeout_ms)) continue;
+        HashRing previous;
+        {
+            std::unique_lock<std::shared_mutex> lock(ring_mutex_);
+            alive_[node] = false;
+            previous = ring_;
+            ring_.build(ids_, alive_, config_.cluster_virtual_nodes);
+        }
+        logger_->warn("Узел кластера {} недоступен", ids_[node]);
+        membership_changed(node, previous);
+    }
+}
+
+// Перераспределение затрагивает только ключи, у которых сменился владелец или резервный узел
+void ClusterNode::membership_changed(int failed_node, const HashRing& previous) {
+    // Уведомления, накопленные до смены кольца, разбираем сначала, чтобы owned_ был актуален
+    flush_pending();
+    HashRing ring;
+    {
+        std::shared_lock<std::shared_mutex> lock(ring_mutex_);
+        ring = ring_;
+    }
+
+    // Реплики упавшего узла: свои поднимаем в движок, чужие отдаём новым владельцам
+    std::vector<SessionRecord> promoted;
+    std::map<int, std::vector<SessionRecord>> handoff;
+    if (failed_node >= 0) {
+        std::lock_guard<std::mutex> lock(replica_mutex_);
+        for (auto it = replicas_.begin(); it != replicas_.end();) {
+            if (it->second.primary != failed_node) {
+                ++it;
+                continue;
+            }
+            int owner = ring.owner(it->first);
+            if (owner == self_) {
+                promoted.push_back({it->first, it->second.start_time});
+            } else if (owner >= 0) {
+                handoff[owner].push_back({it->first, it->second.start_time});
+            }
+            it = replicas_.erase(it);
+        }
+    }
+    send_handoff(handoff);
+    if (!promoted.empty()) {
+        // Поднятые сессии реплицируются на резервный узел через уведомления движка
+        engine_.adopt_sessions(promoted);
+        logger_->info("Восстановлено {} сессий узла {}", promoted.size(), ids_[failed_node]);
+    }
+
+    std::vector<uint64_t> moved;
+    std::map<int, std::vector<SessionRecord>> replicate;
+    std::map<int, std::vector<SessionRecord>> expire;
+    for (const auto& session : owned_) {
+        int owner = ring.owner(session.first);
+        if (owner >= 0 && owner != self_) {
+            moved.push_back(session.first);
+            continue;
+        }
+        int backup = ring.successor(session.first, self_);
+        int old_backup = previous.successor(session.first, self_);
+        if (backup == old_backup) continue;
+        if (backup >= 0) replicate[backup].push_back({session.first, session.second});
+        if (old_backup >= 0 && old_backup != failed_node) expire[old_backup].push_back({session.first, 0});
+    }
+    size_t handed_off = hand_off(moved, ring, &previous);
+    if (handed_off > 0) {
+        logger_->info("Передано {} сессий новым владельцам", handed_off);
+    }
+    send_grouped(CLUSTER_REPLICATE, replicate);
+    send_grouped(CLUSTER_EXPIRE, expire);
+}
+
+// Передаёт сессии владельцам по ring. previous — кольцо, по которому сессии реплицировались:
+// прежний резервный узел получает EXPIRE, чтобы устаревшая реплика не ожила при следующем отказе.
+size_t ClusterNode::hand_off(const std::vector<uint64_t>& keys, const HashRing& ring, const HashRing* previous) {
+    if (keys.empty()) return 0;
+    std::vector<SessionRecord> moved;
+    engine_.extract_sessions(Span<const uint64_t>(keys.data(), keys.size()), moved);
+    std::map<int, std::vector<SessionRecord>> handoff;
+    std::map<int, std::vector<SessionRecord>> expire;
+    for (const auto& record : moved) {
+        owned_.erase(record.imsi_key);
+        int owner = ring.owner(record.imsi_key);
+        handoff[owner].push_back(record);
+        if (!previous) continue;
+        // Новый владелец, бывший резервным, снимает реплику сам при приёме HANDOFF
+        int old_backup = previous->successor(record.imsi_key, self_);
+        if (old_backup >= 0 && old_backup != owner && is_alive(old_backup)) {
+            expire[old_backup].push_back({record.imsi_key, 0});
+        }
+    }
+    send_grouped(CLUSTER_EXPIRE, expire);
+    send_handoff(handoff);
+    return moved.size();
+}
+
+// Сессии уже удалены из движка и реплик, поэтому до подтверждения они хранятся только здесь
+void ClusterNode::send_handoff(const std::map<int, std::vector<SessionRecord>>& groups) {
+    auto now = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(handoff_mutex_);
+        for (const auto& group : groups) {
+            for (const auto& record : group.second) {
+                handoffs_[record.imsi_key] = {record, group.first, now, 1};
+            }
+        }
+    }
+    send_grouped(CLUSTER_HANDOFF, groups);
+}
+
+// Неподтверждённые передачи повторяются текущему владельцу; если владельцем стал этот узел
+// или попытки исчерпаны, сессии возвращаются в движок (и при необходимости передаются заново)
+void ClusterNode::retry_handoffs(std::chrono::steady_clock::time_point now) {
+    HashRing ring;
+    {
+        std::shared_lock<std::shared_mutex> lock(ring_mutex_);
+        ring = ring_;
+    }
+    std::map<int, std::vector<SessionRecord>> resend;
+    std::vector<SessionRecord> readopt;
+    {
+        std::lock_guard<std::mutex> lock(handoff_mutex_);
+        for (auto it = handoffs_.begin(); it != handoffs_.end();) {
+            Handoff& handoff = it->second;
+            if (now - handoff.sent < std::chrono::milliseconds(CLUSTER_HANDOFF_RETRY_MS)) {
+                ++it;
+                continue;
+            }
+            int owner = ring.owner(it->first);
+            if (owner < 0 || owner == self_ || handoff.attempts >= CLUSTER_HANDOFF_ATTEMPTS) {
+                readopt.push_back(handoff.record);
+                it = handoffs_.erase(it);
+                continue;
+            }
+            handoff.owner = owner;
+            handoff.sent = now;
+            ++handoff.attempts;
+            resend[owner].push_back(handoff.record);
+            ++it;
+        }
+    }
+    send_grouped(CLUSTER_HANDOFF, resend);
+    if (!readopt.empty()) {
+        size_t adopted = engine_.adopt_sessions(readopt);
+        logger_->warn("Передача {} сессий не подтверждена, возвращено в движок: {}", readopt.size(), adopted);
+    }
+}
+
+void ClusterNode::flush_pending() {
+    std::vector<SessionEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        events.swap(pending_);
+    }
+    if (events.empty()) return;
+
+    HashRing ring;
+    {
+        std::shared_lock<std::shared_mutex> lock(ring_mutex_);
+        ring = ring_;
+    }
+
+    // Для каждого затронутого ключа важно только итоговое состояние после всех уведомлений
+    std::vector<uint64_t> touched;
+    touched.reserve(events.size());
+    for (const auto& event : events) {
+        if (event.created) {
+            owned_[event.imsi_key] = event.start_time;
+        } else {
+            owned_.erase(event.imsi_key);
+        }
+        touched.push_back(event.imsi_key);
+    }
+    std::sort(touched.begin(), touched.end());
+    touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+
+    std::map<int, std::vector<SessionRecord>> replicate;
+    std::map<int, std::vector<SessionRecord>> expire;
+    std::vector<uint64_t> misplaced;
+    for (uint64_t key : touched) {
+        auto it = owned_.find(key);
+        int backup = ring.successor(key, self_);
+        if (it == owned_.end()) {
+            if (backup >= 0) expire[backup].push_back({key, 0});
+            continue;
+        }
+        int owner = ring.owner(key);
+        if (owner >= 0 && owner != self_) {
+            misplaced.push_back(key);
+            continue;
+        }
+        if (backup >= 0) replicate[backup].push_back({key, it->second});
+    }
+    send_grouped(CLUSTER_REPLICATE, replicate);
+    send_grouped(CLUSTER_EXPIRE, expire);
+
+    // Сессии, созданные не на своём узле (смешанный пакет, расхождение представлений о кольце);
+    // они ещё не реплицировались, поэтому прежнего резервного узла нет
+    hand_off(misplaced, ring, nullptr);
+}
+
+void ClusterNode::purge_replicas() {
+    time_t now = engine_.now();
+    uint32_t timeout = engine_.config()->config.session_timeout_sec;
+    std::lock_guard<std::mutex> lock(replica_mutex_);
+    for (auto it = replicas_.begin(); it != replicas_.end();) {
+        if (difftime(now, it->second.start_time) > timeout) {
+            it = replicas_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef CLUSTER_NODE_H
+#define CLUSTER_NODE_H
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "hash_ring.h"
+#include "pgw_engine.h"
+#include "../Configs/pgw_server_config.h"
+#include "spdlog/spdlog.h"
+
+#define CLUSTER_TICK_MS 50
+#define CLUSTER_HANDOFF_RETRY_MS 500 // повтор HANDOFF без подтверждения
+#define CLUSTER_HANDOFF_ATTEMPTS 4   // после стольких попыток сессии возвращаются в движок
+
+// Приём запроса, пересланного узлом sender: обработчик только ставит его в очередь рабочих потоков
+// (false — очередь заполнена), ответ потом отправляется через ClusterNode::reply().
+// Вызывается в потоке кластера, который отвечает и за heartbeat, поэтому блокироваться не должен.
+using ForwardHandler = std::function<bool(const uint8_t* data, size_t len, const struct sockaddr_in& client, int sender)>;
+
+// Узел кластера: владение IMSI по консистентному хешу, пересылка чужих запросов владельцу,
+// асинхронная репликация создания/удаления сессий на следующий по кольцу узел и
+// перераспределение сессий при изменении состава живых узлов.
+class ClusterNode : public SessionListener {
+public:
+    ClusterNode(const pgw_server_config& config, PgwEngine& engine, std::shared_ptr<spdlog::logger> logger);
+    ~ClusterNode() override;
+
+    // client_sockfd — UDP-сокет клиентов, через него уходят ответы на пересланные запросы
+    bool start(int client_sockfd, ForwardHandler handler);
+    void stop();
+
+    // true — датаграмма переслана владельцу и локально не обрабатывается
+    bool route(const uint8_t* data, size_t len, const struct sockaddr_in& client);
+
+    // Ответ на пересланный запрос; потокобезопасен, вызывается из рабочих потоков
+    void reply(int sender, const struct sockaddr_in& client, const uint8_t* response, size_t len);
+
+    int self() const { return self_; }
+    int owner_of(uint64_t imsi_key);
+    bool is_alive(int node);
+    size_t replica_count();
+    // Переданные владельцам сессии, приём которых ещё не подтверждён
+    size_t handoffs_in_flight();
+
+    void on_session_created(uint64_t imsi_key, time_t start_time) override;
+    void on_session_removed(uint64_t imsi_key) override;
+
+private:
+    struct Replica {
+        time_t start_time;
+        int primary;
+    };
+
+    struct Handoff {
+        SessionRecord record;
+        int owner;
+        std::chrono::steady_clock::time_point sent;
+        uint32_t attempts;
+    };
+
+    struct SessionEvent {
+        uint64_t imsi_key;
+        time_t start_time;
+        bool created;
+    };
+
+    void run();
+    void handle_message(const uint8_t* data, size_t len);
+    void send_to(int node, const uint8_t* data, size_t len);
+    void send_records(int node, uint8_t type, const std::vector<SessionRecord>& records);
+    void send_grouped(uint8_t type, const std::map<int, std::vector<SessionRecord>>& groups);
+    void mark_alive(int node);
+    void check_failures(std::chrono::steady_clock::time_point now);
+    void membership_changed(int failed_node, const HashRing& previous);
+    size_t hand_off(const std::vector<uint64_t>& keys, const HashRing& ring, const HashRing* previous);
+    void send_handoff(const std::map<int, std::vector<SessionRecord>>& groups);
+    void retry_handoffs(std::chrono::steady_clock::time_point now);
+    void flush_pending();
+    void purge_replicas();
+
+    pgw_server_config config_;
+    PgwEngine& engine_;
+    std::shared_ptr<spdlog::logger> logger_;
+
+    int self_ = -1;
+    std::vector<std::string> ids_;
+    std::vector<struct sockaddr_in> addrs_;
+    int sockfd_ = -1;
+    int client_sockfd_ = -1;
+    ForwardHandler handler_;
+    std::thread thread_;
+    std::atomic<bool> running_{false};
+
+    std::shared_mutex ring_mutex_;
+    HashRing ring_;
+    std::vector<bool> alive_;
+    std::vector<std::chrono::steady_clock::time_point> last_seen_; // только поток кластера
+
+    std::mutex pending_mutex_;
+    std::vector<SessionEvent> pending_; // в порядке уведомлений движка
+
+    // Сессии движка, собранные по уведомлениям: перераспределение обходит их без блокировки таблицы сессий.
+    // Только поток кластера (и start() до его запуска).
+    std::unordered_map<uint64_t, time_t> owned_;
+
+    std::mutex handoff_mutex_;
+    std::unordered_map<uint64_t, Handoff> handoffs_; // извлечены из движка, ждут HANDOFF_ACK
+
+    std::mutex replica_mutex_;
+    std::unordered_map<uint64_t, Replica> replicas_; // копии сессий, для которых узел — резервный
+};
+
+#endif
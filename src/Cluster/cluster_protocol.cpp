@@ -0,0 +1,84 @@
+#include "cluster_protocol.h"
+#include <cstring>
+#include "../Utils/byte_order.h"
+
+static size_t record_size(uint8_t type) {
+    return type == CLUSTER_EXPIRE || type == CLUSTER_HANDOFF_ACK ? 8 : 16;
+}
+
+static void write_header(uint8_t* out, uint8_t type, uint8_t sender) {
+    out[0] = CLUSTER_MAGIC;
+    out[1] = CLUSTER_VERSION;
+    out[2] = type;
+    out[3] = sender;
+}
+
+SessionRecord ClusterMessage::record(size_t i) const {
+    const uint8_t* p = records + i * record_size(type);
+    return {read_u64(p), record_size(type) == 8 ? 0 : static_cast<time_t>(read_u64(p + 8))};
+}
+
+bool parse_cluster_message(const uint8_t* data, size_t bytes_received, ClusterMessage& message) {
+    if (bytes_received < CLUSTER_HEADER_SIZE || data[0] != CLUSTER_MAGIC || data[1] != CLUSTER_VERSION) return false;
+    message = ClusterMessage();
+    message.type = data[2];
+    message.sender = data[3];
+    const uint8_t* body = data + CLUSTER_HEADER_SIZE;
+    size_t body_len = bytes_received - CLUSTER_HEADER_SIZE;
+
+    switch (message.type) {
+        case CLUSTER_HEARTBEAT:
+            return body_len == 0;
+        case CLUSTER_FORWARD:
+        case CLUSTER_FORWARD_REPLY:
+            if (body_len <= 6) return false;
+            message.client.sin_family = AF_INET;
+            memcpy(&message.client.sin_addr.s_addr, body, 4);
+            memcpy(&message.client.sin_port, body + 4, 2);
+            message.payload = body + 6;
+            message.payload_len = body_len - 6;
+            return true;
+        case CLUSTER_REPLICATE:
+        case CLUSTER_EXPIRE:
+        case CLUSTER_HANDOFF:
+        case CLUSTER_HANDOFF_ACK:
+            if (body_len < 2) return false;
+            message.count = read_u16(body);
+            if (message.count > CLUSTER_MAX_RECORDS || body_len != 2 + message.count * record_size(message.type)) return false;
+            message.records = body + 2;
+            return true;
+    }
+    return false;
+}
+
+size_t encode_cluster_heartbeat(uint8_t sender, uint8_t* out, size_t out_size) {
+    if (out_size < CLUSTER_HEADER_SIZE) return 0;
+    write_header(out, CLUSTER_HEARTBEAT, sender);
+    return CLUSTER_HEADER_SIZE;
+}
+
+size_t encode_cluster_forward(uint8_t type, uint8_t sender, const struct sockaddr_in& client,
+                              const uint8_t* payload, size_t payload_len, uint8_t* out, size_t out_size) {
+    size_t size = CLUSTER_HEADER_SIZE + 6 + payload_len;
+    if (payload_len == 0 || size > out_size) return 0;
+    write_header(out, type, sender);
+    // адрес и порт уже в сетевом порядке
+    memcpy(out + CLUSTER_HEADER_SIZE, &client.sin_addr.s_addr, 4);
+    memcpy(out + CLUSTER_HEADER_SIZE + 4, &client.sin_port, 2);
+    memcpy(out + CLUSTER_HEADER_SIZE + 6, payload, payload_len);
+    return size;
+}
+
+size_t encode_cluster_records(uint8_t type, uint8_t sender, const SessionRecord* records, size_t count,
+                              uint8_t* out, size_t out_size) {
+    size_t size = CLUSTER_HEADER_SIZE + 2 + count * record_size(type);
+    if (count == 0 || count > CLUSTER_MAX_RECORDS || size > out_size) return 0;
+    write_header(out, type, sender);
+    write_u16(out + CLUSTER_HEADER_SIZE, static_cast<uint16_t>(count));
+    uint8_t* p = out + CLUSTER_HEADER_SIZE + 2;
+    for (size_t i = 0; i < count; ++i, p += record_size(type)) {
+        write_u64(p, records[i].imsi_key);
+        if (record_size(type) == 16) write_u64(p + 8, static_cast<uint64_t>(records[i].start_time));
+    }
+    return size;
+}
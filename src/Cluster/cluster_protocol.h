@@ -0,0 +1,56 @@
+#ifndef CLUSTER_PROTOCOL_H
+#define CLUSTER_PROTOCOL_H
+
+#include <arpa/inet.h>
+#include <cstddef>
+#include <cstdint>
+#include "pgw_engine.h"
+
+// Межузловой протокол поверх UDP (сетевой порядок байт):
+//   заголовок: magic(1) version(1) type(1) sender(1) — sender это индекс узла в конфиге
+//   HEARTBEAT:            только заголовок
+//   FORWARD/FORWARD_REPLY: client_ip(4) client_port(2) исходная датаграмма / ответ клиенту
+//   REPLICATE/HANDOFF:    count(2) + count * (imsi_key(8) start_time(8))
+//   EXPIRE/HANDOFF_ACK:   count(2) + count * imsi_key(8)
+
+#define CLUSTER_MAGIC 0xBC
+#define CLUSTER_VERSION 1
+#define CLUSTER_HEADER_SIZE 4
+#define CLUSTER_MAX_MESSAGE 8192
+#define CLUSTER_MAX_RECORDS 256
+
+enum ClusterMessageType : uint8_t {
+    CLUSTER_HEARTBEAT = 1,
+    CLUSTER_FORWARD = 2,
+    CLUSTER_FORWARD_REPLY = 3,
+    CLUSTER_REPLICATE = 4,
+    CLUSTER_EXPIRE = 5,
+    CLUSTER_HANDOFF = 6,
+    CLUSTER_HANDOFF_ACK = 7 // подтверждение приёма HANDOFF, до него отправитель хранит сессии у себя
+};
+
+// Разобранное сообщение; payload и records указывают внутрь исходного буфера
+struct ClusterMessage {
+    uint8_t type = 0;
+    uint8_t sender = 0;
+    struct sockaddr_in client = {};
+    const uint8_t* payload = nullptr;
+    size_t payload_len = 0;
+    const uint8_t* records = nullptr;
+    size_t count = 0;
+
+    SessionRecord record(size_t i) const;
+};
+
+bool parse_cluster_message(const uint8_t* data, size_t bytes_received, ClusterMessage& message);
+
+size_t encode_cluster_heartbeat(uint8_t sender, uint8_t* out, size_t out_size);
+
+size_t encode_cluster_forward(uint8_t type, uint8_t sender, const struct sockaddr_in& client,
+                              const uint8_t* payload, size_t payload_len, uint8_t* out, size_t out_size);
+
+// Для EXPIRE и HANDOFF_ACK start_time не передаётся
+size_t encode_cluster_records(uint8_t type, uint8_t sender, const SessionRecord* records, size_t count,
+                              uint8_t* out, size_t out_size);
+
+#endif
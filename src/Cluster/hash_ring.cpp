@@ -0,0 +1,54 @@
+#include "hash_ring.h"
+#include <algorithm>
+
+static uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t fnv1a64(const std::string& s) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (unsigned char c : s) {
+        hash ^= c;
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+uint64_t hash_imsi_key(uint64_t imsi_key) {
+    return splitmix64(imsi_key);
+}
+
+void HashRing::build(const std::vector<std::string>& node_ids, const std::vector<bool>& alive, uint32_t virtual_nodes) {
+    points_.clear();
+    for (size_t node = 0; node < node_ids.size(); ++node) {
+        if (!alive[node]) continue;
+        uint64_t base = fnv1a64(node_ids[node]);
+        for (uint32_t v = 0; v < virtual_nodes; ++v) {
+            points_.emplace_back(splitmix64(base ^ (static_cast<uint64_t>(v) * 0x9E3779B97F4A7C15ULL)), static_cast<int>(node));
+        }
+    }
+    std::sort(points_.begin(), points_.end());
+}
+
+size_t HashRing::lower_bound(uint64_t hash) const {
+    auto it = std::lower_bound(points_.begin(), points_.end(), std::make_pair(hash, -1));
+    return it == points_.end() ? 0 : it - points_.begin();
+}
+
+int HashRing::owner(uint64_t imsi_key) const {
+    if (points_.empty()) return -1;
+    return points_[lower_bound(hash_imsi_key(imsi_key))].second;
+}
+
+int HashRing::successor(uint64_t imsi_key, int exclude) const {
+    if (points_.empty()) return -1;
+    size_t start = lower_bound(hash_imsi_key(imsi_key));
+    for (size_t i = 0; i < points_.size(); ++i) {
+        int node = points_[(start + i) % points_.size()].second;
+        if (node != exclude) return node;
+    }
+    return -1;
+}
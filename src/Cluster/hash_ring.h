@@ -0,0 +1,30 @@
+#ifndef HASH_RING_H
+#define HASH_RING_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+uint64_t hash_imsi_key(uint64_t imsi_key);
+
+// Консистентное хеширование ключей IMSI по узлам; узлы задаются индексами в списке конфига
+class HashRing {
+public:
+    void build(const std::vector<std::string>& node_ids, const std::vector<bool>& alive, uint32_t virtual_nodes);
+
+    // -1, если живых узлов нет
+    int owner(uint64_t imsi_key) const;
+
+    // Следующий по кольцу узел, отличный от exclude; -1, если такого нет
+    int successor(uint64_t imsi_key, int exclude) const;
+
+    bool empty() const { return points_.empty(); }
+
+private:
+    size_t lower_bound(uint64_t hash) const;
+
+    std::vector<std::pair<uint64_t, int>> points_; // отсортированы по хешу
+};
+
+#endif
@@ -11,6 +11,8 @@ struct pgw_client_config
   uint32_t server_port;
   std::string log_file;
   std::string log_level;
+  // Повтор после потерянного ответа даёт на сервере ещё одну CDR-запись created
+  uint32_t max_retries = 3;
 };
 
 
@@ -8,6 +8,13 @@
 
 
 
+struct pgw_cluster_node
+{
+  std::string id;
+  std::string ip;
+  uint32_t port; // UDP-порт межузлового протокола
+};
+
 struct pgw_server_config
 {
 
@@ -15,11 +22,24 @@ struct pgw_server_config
   uint32_t udp_port;
   uint32_t session_timeout_sec;
   std::string cdr_file;
+  uint64_t cdr_rotate_bytes = 64ULL * 1024 * 1024; // 0 — без ротации
+  uint32_t cdr_index_capacity = 256 * 1024;       // записей в памяти для активного CDR-файла
   uint32_t http_port;
   uint32_t graceful_shutdown_rate;
   std::string log_file;
   std::string log_level;
   std::vector<std::string> blacklist;
+  std::string shm_name;   // необязательный канал в разделяемой памяти, например "/pgw_ingest"
+  uint32_t shm_slots = 1024;
+  std::string cluster_node_id; // пусто — кластерный режим выключен
+  std::vector<pgw_cluster_node> cluster_nodes;
+  uint32_t cluster_virtual_nodes = 64;
+  uint32_t cluster_heartbeat_ms = 500;
+  uint32_t cluster_failure_timeout_ms = 2000;
+  uint32_t workers_min = 2;
+  uint32_t workers_max = 8;
+  std::string capture_file;       // пусто — захват трафика выключен
+  uint32_t trace_sample_rate = 0; // трассируется каждый N-й пакет, 0 — выключено
 
 };
 
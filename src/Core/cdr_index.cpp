@@ -0,0 +1,231 @@
+#include "cdr_index.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../Utils/utils.h"
+
+void format_cdr_time(time_t timestamp, char* out) {
+    struct tm tm_utc;
+    gmtime_r(&timestamp, &tm_utc);
+    strftime(out, CDR_TIME_SIZE + 1, "%Y-%m-%dT%H:%M:%SZ", &tm_utc);
+}
+
+static bool parse_number(const char* s, size_t len, int& value) {
+    value = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (s[i] < '0' || s[i] > '9') return false;
+        value = value * 10 + (s[i] - '0');
+    }
+    return true;
+}
+
+bool parse_cdr_record(const char* line, size_t len, int64_t& timestamp, uint64_t& imsi_key) {
+    timestamp = 0;
+    if (len > CDR_TIME_SIZE + 2 && line[4] == '-' && line[10] == 'T' && line[CDR_TIME_SIZE - 1] == 'Z') {
+        struct tm tm_utc;
+        memset(&tm_utc, 0, sizeof(tm_utc));
+        if (!parse_number(line, 4, tm_utc.tm_year) || !parse_number(line + 5, 2, tm_utc.tm_mon) ||
+            !parse_number(line + 8, 2, tm_utc.tm_mday) || !parse_number(line + 11, 2, tm_utc.tm_hour) ||
+            !parse_number(line + 14, 2, tm_utc.tm_min) || !parse_number(line + 17, 2, tm_utc.tm_sec)) {
+            return false;
+        }
+        tm_utc.tm_year -= 1900;
+        tm_utc.tm_mon -= 1;
+        timestamp = timegm(&tm_utc);
+        line += CDR_TIME_SIZE + 2;
+        len -= CDR_TIME_SIZE + 2;
+    }
+    const char* comma = static_cast<const char*>(memchr(line, ',', len));
+    if (!comma) return false;
+    imsi_key = imsi_key_from_digits(line, comma - line);
+    return imsi_key != IMSI_KEY_INVALID;
+}
+
+#define CDR_CHAIN_END UINT32_MAX
+
+void CdrIndexBuilder::reserve(size_t records) {
+    entries_.reserve(records);
+    next_.reserve(records);
+    chains_.reserve(records / 4);
+    blocks_.reserve(records / CDR_TIME_BLOCK_RECORDS + 1);
+}
+
+void CdrIndexBuilder::add(uint64_t imsi_key, int64_t timestamp, uint64_t offset) {
+    // Метка блока — максимум времени до его начала, поэтому блоки упорядочены даже при скачках часов
+    if (entries_.size() % CDR_TIME_BLOCK_RECORDS == 0) blocks_.push_back({max_time_, offset});
+    uint32_t index = static_cast<uint32_t>(entries_.size());
+    entries_.push_back({imsi_key, timestamp, offset});
+    next_.push_back(CDR_CHAIN_END);
+    auto chain = chains_.find(imsi_key);
+    if (chain == chains_.end()) {
+        chains_.emplace(imsi_key, Chain{index, index});
+    } else {
+        next_[chain->second.last] = index;
+        chain->second.last = index;
+    }
+    min_time_ = std::min(min_time_, timestamp);
+    max_time_ = std::max(max_time_, timestamp);
+}
+
+void CdrIndexBuilder::clear() {
+    entries_.clear();
+    next_.clear();
+    chains_.clear();
+    blocks_.clear();
+    min_time_ = INT64_MAX;
+    max_time_ = INT64_MIN;
+}
+
+size_t CdrIndexBuilder::lookup(uint64_t imsi_key, int64_t from, int64_t to, std::vector<CdrIndexEntry>& out,
+                               size_t limit) const {
+    auto chain = chains_.find(imsi_key);
+    if (chain == chains_.end()) return 0;
+    size_t found = 0;
+    for (uint32_t i = chain->second.first; i != CDR_CHAIN_END && found < limit; i = next_[i]) {
+        const CdrIndexEntry& entry = entries_[i];
+        if (entry.timestamp >= from && entry.timestamp <= to) {
+            out.push_back(entry);
+            ++found;
+        }
+    }
+    return found;
+}
+
+static uint64_t seek_blocks(const CdrTimeBlock* begin, const CdrTimeBlock* end, int64_t from) {
+    const CdrTimeBlock* it = std::lower_bound(begin, end, from, [](const CdrTimeBlock& block, int64_t value) {
+        return block.timestamp < value;
+    });
+    if (it == begin) return 0;
+    return (it - 1)->offset;
+}
+
+uint64_t CdrIndexBuilder::time_seek(int64_t from) const {
+    return seek_blocks(blocks_.data(), blocks_.data() + blocks_.size(), from);
+}
+
+bool CdrIndexBuilder::overlaps(int64_t from, int64_t to) const {
+    return !entries_.empty() && min_time_ <= to && max_time_ >= from;
+}
+
+bool CdrIndexBuilder::seal(const std::string& index_path) {
+    std::sort(entries_.begin(), entries_.end(), [](const CdrIndexEntry& a, const CdrIndexEntry& b) {
+        return a.imsi_key != b.imsi_key ? a.imsi_key < b.imsi_key : a.offset < b.offset;
+    });
+
+    CdrIndexHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CDR_INDEX_MAGIC, sizeof(header.magic));
+    header.version = CDR_INDEX_VERSION;
+    header.entry_count = entries_.size();
+    header.block_count = blocks_.size();
+    header.min_time = min_time_;
+    header.max_time = max_time_;
+
+    // Пишем во временный файл и переименовываем, чтобы читатели не увидели недописанный индекс
+    std::string tmp_path = index_path + ".tmp";
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) return false;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries_.data()), entries_.size() * sizeof(CdrIndexEntry));
+    file.write(reinterpret_cast<const char*>(blocks_.data()), blocks_.size() * sizeof(CdrTimeBlock));
+    file.close();
+    if (!file.good()) {
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return std::rename(tmp_path.c_str(), index_path.c_str()) == 0;
+}
+
+bool build_cdr_index(const std::string& cdr_path, CdrIndexBuilder& builder, uint64_t& file_size,
+                     size_t max_records, uint64_t* unindexed_from) {
+    file_size = 0;
+    if (unindexed_from) *unindexed_from = UINT64_MAX;
+    std::ifstream file(cdr_path, std::ios::binary);
+    if (!file.is_open()) return false;
+    std::string line;
+    int64_t timestamp;
+    uint64_t imsi_key;
+    while (std::getline(file, line)) {
+        if (parse_cdr_record(line.data(), line.size(), timestamp, imsi_key)) {
+            if (builder.size() < max_records) {
+                builder.add(imsi_key, timestamp, file_size);
+            } else if (unindexed_from && *unindexed_from == UINT64_MAX) {
+                *unindexed_from = file_size;
+            }
+        }
+        file_size += line.size() + (file.eof() ? 0 : 1);
+    }
+    return true;
+}
+
+CdrIndexFile::~CdrIndexFile() {
+    close();
+}
+
+bool CdrIndexFile::open(const std::string& index_path) {
+    close();
+    int fd = ::open(index_path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(CdrIndexHeader)) {
+        ::close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+    map_ = map;
+    map_size_ = st.st_size;
+
+    header_ = static_cast<const CdrIndexHeader*>(map_);
+    size_t expected = sizeof(CdrIndexHeader) + header_->entry_count * sizeof(CdrIndexEntry) +
+                      header_->block_count * sizeof(CdrTimeBlock);
+    if (memcmp(header_->magic, CDR_INDEX_MAGIC, sizeof(header_->magic)) != 0 ||
+        header_->version != CDR_INDEX_VERSION || expected != map_size_) {
+        close();
+        return false;
+    }
+    entries_ = reinterpret_cast<const CdrIndexEntry*>(header_ + 1);
+    blocks_ = reinterpret_cast<const CdrTimeBlock*>(entries_ + header_->entry_count);
+    return true;
+}
+
+void CdrIndexFile::close() {
+    if (map_) munmap(map_, map_size_);
+    map_ = nullptr;
+    map_size_ = 0;
+    header_ = nullptr;
+    entries_ = nullptr;
+    blocks_ = nullptr;
+}
+
+size_t CdrIndexFile::lookup(uint64_t imsi_key, int64_t from, int64_t to, std::vector<CdrIndexEntry>& out,
+                            size_t limit) const {
+    if (!header_) return 0;
+    const CdrIndexEntry* end = entries_ + header_->entry_count;
+    const CdrIndexEntry* it = std::lower_bound(entries_, end, imsi_key, [](const CdrIndexEntry& entry, uint64_t key) {
+        return entry.imsi_key < key;
+    });
+    size_t found = 0;
+    for (; it != end && it->imsi_key == imsi_key && found < limit; ++it) {
+        if (it->timestamp >= from && it->timestamp <= to) {
+            out.push_back(*it);
+            ++found;
+        }
+    }
+    return found;
+}
+
+uint64_t CdrIndexFile::time_seek(int64_t from) const {
+    if (!header_) return 0;
+    return seek_blocks(blocks_, blocks_ + header_->block_count, from);
+}
+
+bool CdrIndexFile::overlaps(int64_t from, int64_t to) const {
+    return header_ && header_->entry_count > 0 && header_->min_time <= to && header_->max_time >= from;
+}
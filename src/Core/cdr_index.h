@@ -0,0 +1,106 @@
+#ifndef CDR_INDEX_H
+#define CDR_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define CDR_INDEX_MAGIC "PGWCDRX1"
+#define CDR_INDEX_VERSION 1
+#define CDR_TIME_BLOCK_RECORDS 256   // шаг разреженного индекса по времени, в записях
+#define CDR_TIME_SIZE 20             // "2026-01-31T23:59:59Z"
+#define CDR_RECORD_MAX 128
+#define CDR_RECORD_MIN 32            // оценка снизу для резервирования индекса активного файла
+
+struct CdrIndexEntry {
+    uint64_t imsi_key;
+    int64_t timestamp;
+    uint64_t offset;
+};
+
+struct CdrTimeBlock {
+    int64_t timestamp;
+    uint64_t offset;
+};
+
+// Заголовок файла <cdr>.idx; за ним entry_count записей CdrIndexEntry, отсортированных по (IMSI, смещение),
+// и block_count записей CdrTimeBlock в порядке файла. Порядок байт — порядок хоста.
+struct CdrIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t entry_count;
+    uint64_t block_count;
+    int64_t min_time;
+    int64_t max_time;
+};
+
+// Время CDR-записи в UTC; out — минимум CDR_TIME_SIZE + 1 байт
+void format_cdr_time(time_t timestamp, char* out);
+
+// Разбор строки "время, IMSI, событие"; у записей старого формата "IMSI, событие" время равно 0
+bool parse_cdr_record(const char* line, size_t len, int64_t& timestamp, uint64_t& imsi_key);
+
+// Индекс CDR-файла в памяти: пополняется при записи и запечатывается в .idx при ротации.
+// Записи одного IMSI связаны в цепочку, поэтому поиск по IMSI не просматривает весь индекс.
+// После reserve() память выделяется только под первую запись нового IMSI.
+class CdrIndexBuilder {
+public:
+    void reserve(size_t records);
+    void add(uint64_t imsi_key, int64_t timestamp, uint64_t offset);
+    void clear();
+    size_t size() const { return entries_.size(); }
+
+    size_t lookup(uint64_t imsi_key, int64_t from, int64_t to, std::vector<CdrIndexEntry>& out, size_t limit) const;
+    uint64_t time_seek(int64_t from) const;
+    bool overlaps(int64_t from, int64_t to) const;
+
+    // Сортирует записи и пишет индексный файл; после этого построитель пригоден только для clear()
+    bool seal(const std::string& index_path);
+
+private:
+    struct Chain {
+        uint32_t first;
+        uint32_t last;
+    };
+
+    std::vector<CdrIndexEntry> entries_;
+    std::vector<uint32_t> next_;                  // следующая запись того же IMSI в порядке файла
+    std::unordered_map<uint64_t, Chain> chains_;
+    std::vector<CdrTimeBlock> blocks_;
+    int64_t min_time_ = INT64_MAX;
+    int64_t max_time_ = INT64_MIN;
+};
+
+// Построение индекса по существующему CDR-файлу за один проход. Индексируется не больше max_records записей;
+// смещение первой не попавшей в индекс записи пишется в unindexed_from (UINT64_MAX — индекс полный).
+bool build_cdr_index(const std::string& cdr_path, CdrIndexBuilder& builder, uint64_t& file_size,
+                     size_t max_records = SIZE_MAX, uint64_t* unindexed_from = nullptr);
+
+// Запечатанный индекс, отображённый в память: поиск по IMSI — двоичный, по времени — через разреженные блоки
+class CdrIndexFile {
+public:
+    CdrIndexFile() = default;
+    ~CdrIndexFile();
+    CdrIndexFile(const CdrIndexFile&) = delete;
+    CdrIndexFile& operator=(const CdrIndexFile&) = delete;
+
+    bool open(const std::string& index_path);
+    void close();
+
+    size_t lookup(uint64_t imsi_key, int64_t from, int64_t to, std::vector<CdrIndexEntry>& out, size_t limit) const;
+    uint64_t time_seek(int64_t from) const;
+    bool overlaps(int64_t from, int64_t to) const;
+
+private:
+    const CdrIndexHeader* header_ = nullptr;
+    const CdrIndexEntry* entries_ = nullptr;
+    const CdrTimeBlock* blocks_ = nullptr;
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+};
+
+#endif
@@ -0,0 +1,262 @@
+#include "cdr_sink.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+#include "../Utils/utils.h"
+
+FileCdrSink::~FileCdrSink() {
+    {
+        std::lock_guard<std::mutex> lock(seal_mutex_);
+        seal_stop_ = true;
+    }
+    seal_cv_.notify_all();
+    if (seal_thread_.joinable()) seal_thread_.join();
+}
+
+bool FileCdrSink::open(const std::string& path, uint64_t rotate_bytes, size_t index_capacity) {
+    wait_sealed();
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+    rotate_bytes_ = rotate_bytes;
+    index_capacity_ = std::max<size_t>(index_capacity, 1);
+    rotated_ = 0;
+    struct stat st;
+    while (stat(rotated_path(rotated_ + 1).c_str(), &st) == 0) ++rotated_;
+
+    // Индекс активного файла резервируется заранее, чтобы запись CDR не выделяла память до ротации
+    index_->clear();
+    index_reserve_ = index_capacity_;
+    if (rotate_bytes_) index_reserve_ = std::min<uint64_t>(index_reserve_, rotate_bytes_ / CDR_RECORD_MIN + 1);
+    index_->reserve(index_reserve_);
+    if (!build_cdr_index(path_, *index_, size_, index_capacity_, &unindexed_from_)) size_ = 0;
+
+    {
+        std::lock_guard<std::mutex> seal_lock(seal_mutex_);
+        sealed_through_ = rotated_;
+        spare_indexes_.clear();
+        if (rotate_bytes_) {
+            // Второй индекс подменяет активный при ротации, пока первый запечатывается
+            spare_indexes_.push_back(std::make_unique<CdrIndexBuilder>());
+            spare_indexes_.back()->reserve(index_reserve_);
+            if (!seal_thread_.joinable()) seal_thread_ = std::thread(&FileCdrSink::seal_loop, this);
+        }
+    }
+
+    file_.open(path, std::ios::app);
+    return file_.is_open();
+}
+
+std::string FileCdrSink::rotated_path(uint32_t number) const {
+    return path_ + "." + std::to_string(number);
+}
+
+bool FileCdrSink::write(time_t timestamp, const char* imsi, size_t imsi_len, const char* event, bool flush) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_.is_open()) return false;
+    if (timestamp != time_cached_) {
+        format_cdr_time(timestamp, time_text_);
+        time_cached_ = timestamp;
+    }
+
+    char record[CDR_RECORD_MAX];
+    size_t event_len = strlen(event);
+    if (CDR_TIME_SIZE + 2 + imsi_len + 2 + event_len + 1 > sizeof(record)) return false;
+    size_t len = 0;
+    memcpy(record, time_text_, CDR_TIME_SIZE);
+    len += CDR_TIME_SIZE;
+    memcpy(record + len, ", ", 2);
+    len += 2;
+    memcpy(record + len, imsi, imsi_len);
+    len += imsi_len;
+    memcpy(record + len, ", ", 2);
+    len += 2;
+    memcpy(record + len, event, event_len);
+    len += event_len;
+    record[len++] = '\n';
+
+    if (rotate_bytes_ && size_ > 0 && (size_ + len > rotate_bytes_ || index_->size() >= index_capacity_)) rotate();
+
+    uint64_t key = imsi_key_from_digits(imsi, imsi_len);
+    if (key != IMSI_KEY_INVALID) {
+        if (index_->size() < index_capacity_) {
+            index_->add(key, timestamp, size_);
+        } else if (unindexed_from_ == UINT64_MAX) {
+            unindexed_from_ = size_;
+        }
+    }
+    file_.write(record, len);
+    size_ += len;
+    if (flush) file_.flush();
+    return file_.good();
+}
+
+void FileCdrSink::flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_.is_open()) file_.flush();
+}
+
+bool FileCdrSink::rotate() {
+    file_.close();
+    std::string target = rotated_path(rotated_ + 1);
+    if (std::rename(path_.c_str(), target.c_str()) != 0) {
+        file_.open(path_, std::ios::app);
+        return false;
+    }
+    ++rotated_;
+    {
+        // Если индекс не записался или неполон (файл открыт с записями сверх ёмкости),
+        // query() восстановит его по самому файлу
+        std::lock_guard<std::mutex> seal_lock(seal_mutex_);
+        SealJob job;
+        job.index = std::move(index_);
+        if (unindexed_from_ == UINT64_MAX) job.index_path = target + ".idx";
+        job.number = rotated_;
+        seal_queue_.push_back(std::move(job));
+        if (!spare_indexes_.empty()) {
+            index_ = std::move(spare_indexes_.back());
+            spare_indexes_.pop_back();
+        }
+    }
+    seal_cv_.notify_all();
+    if (!index_) {
+        // Ротации опережают фоновую запись индексов — единственный случай выделения памяти при записи CDR
+        index_ = std::make_unique<CdrIndexBuilder>();
+        index_->reserve(index_reserve_);
+    }
+    unindexed_from_ = UINT64_MAX;
+    size_ = 0;
+    file_.open(path_, std::ios::app);
+    return file_.is_open();
+}
+
+void FileCdrSink::seal_loop() {
+    std::unique_lock<std::mutex> lock(seal_mutex_);
+    for (;;) {
+        seal_cv_.wait(lock, [this] { return seal_stop_ || !seal_queue_.empty(); });
+        if (seal_queue_.empty()) return;
+        SealJob job = std::move(seal_queue_.front());
+        seal_queue_.pop_front();
+        lock.unlock();
+        if (!job.index_path.empty()) job.index->seal(job.index_path);
+        job.index->clear();
+        lock.lock();
+        spare_indexes_.push_back(std::move(job.index));
+        sealed_through_ = job.number;
+        seal_cv_.notify_all();
+    }
+}
+
+void FileCdrSink::wait_sealed() {
+    uint32_t rotated = rotated_count();
+    std::unique_lock<std::mutex> lock(seal_mutex_);
+    seal_cv_.wait(lock, [&] { return sealed_through_ >= rotated || !seal_thread_.joinable(); });
+}
+
+uint32_t FileCdrSink::rotated_count() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rotated_;
+}
+
+void FileCdrSink::read_entries(std::ifstream& file, const std::vector<CdrIndexEntry>& entries,
+                               std::vector<std::string>& records) {
+    std::string line;
+    for (const CdrIndexEntry& entry : entries) {
+        file.clear();
+        file.seekg(entry.offset);
+        if (std::getline(file, line)) records.push_back(line);
+    }
+}
+
+void FileCdrSink::scan_range(std::ifstream& file, const CdrQuery& query, uint64_t begin, uint64_t end,
+                             std::vector<std::string>& records) {
+    file.clear();
+    file.seekg(begin);
+    uint64_t offset = begin;
+    size_t found = 0;
+    std::string line;
+    int64_t timestamp;
+    uint64_t key;
+    while (offset < end && found < query.limit && std::getline(file, line)) {
+        offset += line.size() + 1;
+        if (!parse_cdr_record(line.data(), line.size(), timestamp, key)) continue;
+        if (query.imsi_key != IMSI_KEY_INVALID && key != query.imsi_key) continue;
+        if (timestamp > query.to) break;
+        if (timestamp >= query.from) {
+            records.push_back(line);
+            ++found;
+        }
+    }
+}
+
+size_t FileCdrSink::query(const CdrQuery& query, std::vector<std::string>& records) {
+    size_t initial = records.size();
+    std::vector<CdrIndexEntry> entries;
+    uint32_t next = 1;
+    while (records.size() - initial < query.limit) {
+        // Индекс, который ещё пишется в фоне, query() не должен строить заново поверх него
+        wait_sealed();
+        uint32_t rotated = rotated_count();
+        for (; next <= rotated && records.size() - initial < query.limit; ++next) {
+            std::string cdr_path = rotated_path(next);
+            CdrIndexFile index;
+            if (!index.open(cdr_path + ".idx")) {
+                // Индекса нет (файл из старой версии или сбой при ротации) — строим его один раз
+                CdrIndexBuilder builder;
+                uint64_t size;
+                if (!build_cdr_index(cdr_path, builder, size) || !builder.seal(cdr_path + ".idx") ||
+                    !index.open(cdr_path + ".idx")) {
+                    continue;
+                }
+            }
+            if (!index.overlaps(query.from, query.to)) continue;
+            std::ifstream file(cdr_path, std::ios::binary);
+            if (!file.is_open()) continue;
+            CdrQuery rest = query;
+            rest.limit = query.limit - (records.size() - initial);
+            if (query.imsi_key != IMSI_KEY_INVALID) {
+                entries.clear();
+                index.lookup(query.imsi_key, query.from, query.to, entries, rest.limit);
+                read_entries(file, entries, records);
+            } else {
+                scan_range(file, rest, index.time_seek(query.from), UINT64_MAX, records);
+            }
+        }
+
+        // Под блокировкой записи только копируем найденные по индексу смещения и открываем файл,
+        // чтение с диска идёт уже без неё
+        std::ifstream file;
+        uint64_t begin = 0;
+        uint64_t end = 0;
+        uint64_t unindexed_from = UINT64_MAX;
+        CdrQuery rest = query;
+        rest.limit = query.limit - (records.size() - initial);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // Ротация между чтением запечатанных файлов и активного — дочитываем новые запечатанные
+            if (rotated_ != rotated) continue;
+            unindexed_from = unindexed_from_;
+            if (rest.limit == 0 || (!index_->overlaps(query.from, query.to) && unindexed_from == UINT64_MAX)) break;
+            file_.flush();
+            file.open(path_, std::ios::binary);
+            end = size_;
+            if (query.imsi_key != IMSI_KEY_INVALID) {
+                entries.clear();
+                index_->lookup(query.imsi_key, query.from, query.to, entries, rest.limit);
+                begin = unindexed_from;
+            } else {
+                begin = index_->time_seek(query.from);
+            }
+        }
+        if (!file.is_open()) break;
+        if (query.imsi_key != IMSI_KEY_INVALID) {
+            read_entries(file, entries, records);
+            rest.limit = query.limit - (records.size() - initial);
+            if (begin != UINT64_MAX && rest.limit > 0) scan_range(file, rest, begin, end, records);
+        } else {
+            scan_range(file, rest, begin, end, records);
+        }
+        break;
+    }
+    return records.size() - initial;
+}
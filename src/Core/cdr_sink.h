@@ -0,0 +1,109 @@
+#ifndef CDR_SINK_H
+#define CDR_SINK_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cdr_index.h"
+
+#define CDR_ROTATE_BYTES_DEFAULT (64ULL * 1024 * 1024)
+#define CDR_INDEX_CAPACITY_DEFAULT (256 * 1024) // записей в индексе активного файла, около 8 МиБ
+#define CDR_QUERY_LIMIT_DEFAULT 1000
+#define CDR_QUERY_LIMIT_MAX 10000
+
+// Приёмник CDR-записей «время, IMSI, событие»; реализация должна быть потокобезопасной
+class CdrSink {
+public:
+    virtual ~CdrSink() = default;
+    virtual bool write(time_t timestamp, const char* imsi, size_t imsi_len, const char* event, bool flush = true) = 0;
+    virtual void flush() {}
+    virtual const std::string& path() const = 0;
+};
+
+struct CdrQuery {
+    uint64_t imsi_key = UINT64_MAX; // IMSI_KEY_INVALID — записи всех абонентов за интервал
+    int64_t from = 0;
+    int64_t to = INT64_MAX;
+    size_t limit = CDR_QUERY_LIMIT_DEFAULT;
+};
+
+// CDR-файл открывается один раз, записи форматируются без промежуточных строк.
+// При превышении rotate_bytes или заполнении индекса файл переименовывается в <path>.N, рядом пишется
+// индекс <path>.N.idx; индекс активного файла хранится в памяти и не больше index_capacity записей.
+// rotate_bytes = 0 отключает ротацию: тогда записи сверх index_capacity не индексируются,
+// и запрос дочитывает их последовательно.
+// Индекс ротированного файла сортируется и пишется на диск в фоновом потоке: при ротации под блокировкой
+// записи он только меняется местами с заранее зарезервированным пустым.
+class FileCdrSink : public CdrSink {
+public:
+    ~FileCdrSink() override;
+
+    bool open(const std::string& path, uint64_t rotate_bytes = CDR_ROTATE_BYTES_DEFAULT,
+              size_t index_capacity = CDR_INDEX_CAPACITY_DEFAULT);
+    bool write(time_t timestamp, const char* imsi, size_t imsi_len, const char* event, bool flush = true) override;
+    void flush() override;
+    const std::string& path() const override { return path_; }
+
+    // Записи в порядке времени: ротированные файлы от старых к новым, затем активный
+    size_t query(const CdrQuery& query, std::vector<std::string>& records);
+    uint32_t rotated_count();
+    // Ждёт, пока индексы всех ротированных файлов будут записаны
+    void wait_sealed();
+
+private:
+    struct SealJob {
+        std::unique_ptr<CdrIndexBuilder> index;
+        std::string index_path; // пусто — индекс неполон и не пишется
+        uint32_t number;
+    };
+
+    bool rotate();
+    void seal_loop();
+    std::string rotated_path(uint32_t number) const;
+    // Чтение идёт по уже открытому потоку: активный файл открывается под блокировкой,
+    // а читается после неё, и ротация не подменяет файл посреди чтения
+    static void read_entries(std::ifstream& file, const std::vector<CdrIndexEntry>& entries,
+                             std::vector<std::string>& records);
+    static void scan_range(std::ifstream& file, const CdrQuery& query, uint64_t begin, uint64_t end,
+                           std::vector<std::string>& records);
+
+    std::mutex mutex_;
+    std::ofstream file_;
+    std::string path_;
+    uint64_t rotate_bytes_ = 0;
+    size_t index_capacity_ = CDR_INDEX_CAPACITY_DEFAULT;
+    uint64_t size_ = 0;
+    uint64_t unindexed_from_ = UINT64_MAX; // смещение первой записи, не попавшей в индекс
+    uint32_t rotated_ = 0;
+    size_t index_reserve_ = 0;
+    std::unique_ptr<CdrIndexBuilder> index_ = std::make_unique<CdrIndexBuilder>();
+
+    std::mutex seal_mutex_; // берётся под mutex_, но не наоборот
+    std::condition_variable seal_cv_;
+    std::deque<SealJob> seal_queue_;
+    std::vector<std::unique_ptr<CdrIndexBuilder>> spare_indexes_; // очищенные, с зарезервированной памятью
+    uint32_t sealed_through_ = 0; // номер последнего ротированного файла, индекс которого обработан
+    bool seal_stop_ = false;
+    std::thread seal_thread_;
+    time_t time_cached_ = -1;
+    char time_text_[CDR_TIME_SIZE + 1];
+};
+
+class NullCdrSink : public CdrSink {
+public:
+    bool write(time_t, const char*, size_t, const char*, bool) override { return true; }
+    const std::string& path() const override { return path_; }
+
+private:
+    std::string path_;
+};
+
+#endif
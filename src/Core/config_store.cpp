@@ -0,0 +1,34 @@
+#include "config_store.h"
+#include <algorithm>
+#include "../Utils/utils.h"
+#include "spdlog/sinks/null_sink.h"
+
+bool ConfigSnapshot::is_blacklisted(uint64_t imsi_key) const {
+    return std::binary_search(blacklist.begin(), blacklist.end(), imsi_key);
+}
+
+ConfigStore::ConfigStore(const pgw_server_config& config, std::shared_ptr<spdlog::logger> logger)
+    : logger_(std::move(logger)) {
+    if (!logger_) logger_ = std::make_shared<spdlog::logger>("config_store", std::make_shared<spdlog::sinks::null_sink_mt>());
+    publish(config);
+}
+
+ConfigSnapshotPtr ConfigStore::publish(const pgw_server_config& config) {
+    std::lock_guard<std::mutex> lock(publish_mutex_);
+    auto snapshot = std::make_shared<ConfigSnapshot>();
+    snapshot->version = next_version_++;
+    snapshot->config = config;
+    for (const auto& imsi : config.blacklist) {
+        uint64_t key = imsi_key_from_string(imsi);
+        if (key == IMSI_KEY_INVALID) {
+            logger_->warn("Некорректный IMSI в черном списке: {}", imsi);
+            continue;
+        }
+        snapshot->blacklist.push_back(key);
+    }
+    std::sort(snapshot->blacklist.begin(), snapshot->blacklist.end());
+
+    ConfigSnapshotPtr published = std::move(snapshot);
+    std::atomic_store_explicit(&current_, published, std::memory_order_release);
+    return published;
+}
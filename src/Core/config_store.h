@@ -0,0 +1,41 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "../Configs/pgw_server_config.h"
+#include "spdlog/spdlog.h"
+
+// Неизменяемая версия конфигурации вместе с производными от неё данными
+struct ConfigSnapshot {
+    uint64_t version;
+    pgw_server_config config;
+    std::vector<uint64_t> blacklist; // отсортированные ключи IMSI
+
+    bool is_blacklisted(uint64_t imsi_key) const;
+};
+
+using ConfigSnapshotPtr = std::shared_ptr<const ConfigSnapshot>;
+
+// Текущая конфигурация для горячего пути: чтение — атомарная загрузка shared_ptr без выделения памяти.
+// Версия живёт, пока на неё есть хотя бы один дескриптор, и освобождается после публикации следующей.
+class ConfigStore {
+public:
+    explicit ConfigStore(const pgw_server_config& config, std::shared_ptr<spdlog::logger> logger = nullptr);
+
+    ConfigSnapshotPtr current() const { return std::atomic_load_explicit(&current_, std::memory_order_acquire); }
+    uint64_t version() const { return current()->version; }
+
+    // Публикует новую версию; config должен быть уже проверен validate_pgw_server_config
+    ConfigSnapshotPtr publish(const pgw_server_config& config);
+
+private:
+    std::shared_ptr<spdlog::logger> logger_;
+    std::mutex publish_mutex_;
+    uint64_t next_version_ = 1;
+    ConfigSnapshotPtr current_;
+};
+
+#endif
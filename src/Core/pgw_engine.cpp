@@ -0,0 +1,200 @@
+#include "pgw_engine.h"
+#include <algorithm>
+#include <string_view>
+#include "trace.h"
+#include "../Utils/utils.h"
+#include "spdlog/sinks/null_sink.h"
+
+namespace {
+
+bool starts_later(const SessionRecord& a, const SessionRecord& b) {
+    return a.start_time > b.start_time;
+}
+
+} // namespace
+
+PgwEngine::PgwEngine(const pgw_server_config& config, std::shared_ptr<spdlog::logger> logger,
+                     std::shared_ptr<CdrSink> cdr, EngineClock clock)
+    : PgwEngine(std::make_shared<ConfigStore>(config, logger), logger, std::move(cdr), std::move(clock)) {}
+
+PgwEngine::PgwEngine(std::shared_ptr<ConfigStore> store, std::shared_ptr<spdlog::logger> logger,
+                     std::shared_ptr<CdrSink> cdr, EngineClock clock)
+    : config_(std::move(store)), logger_(std::move(logger)), cdr_(std::move(cdr)), clock_(std::move(clock)) {
+    if (!logger_) logger_ = std::make_shared<spdlog::logger>("pgw_engine", std::make_shared<spdlog::sinks::null_sink_mt>());
+    if (!cdr_) cdr_ = std::make_shared<NullCdrSink>();
+    if (!clock_) clock_ = [] { return time(nullptr); };
+
+    sessions_.reserve(SESSIONS_RESERVE);
+    expiry_.reserve(SESSIONS_RESERVE);
+}
+
+bool PgwEngine::is_blacklisted(uint64_t imsi_key) const {
+    return config_->current()->is_blacklisted(imsi_key);
+}
+
+void PgwEngine::track_expiry(uint64_t imsi_key, time_t start_time) {
+    expiry_.push_back({imsi_key, start_time});
+    std::push_heap(expiry_.begin(), expiry_.end(), starts_later);
+}
+
+void PgwEngine::write_cdr(uint64_t imsi_key, const char* event, bool flush) {
+    char digits[IMSI_MAX_DIGITS + 1];
+    size_t len = imsi_key_to_digits(imsi_key, digits);
+    if (!cdr_->write(clock_(), digits, len, event, flush)) {
+        logger_->error("Не удалось открыть CDR-файл: {}", cdr_->path());
+    }
+}
+
+size_t PgwEngine::process_batch(Span<const Request> requests, Span<Response> responses, const char* source) {
+    size_t count = std::min(requests.size(), responses.size());
+    char digits[IMSI_MAX_DIGITS + 1];
+    ConfigSnapshotPtr config = config_->current();
+
+    TraceSpan log_span(TRACE_STAGE_LOG);
+    for (size_t i = 0; i < count; ++i) {
+        const Request& request = requests[i];
+        responses[i].id = request.id;
+        if (request.imsi_key == IMSI_KEY_INVALID) {
+            logger_->warn("Некорректный BCD-IMSI в запросе {} от {}", request.id, source);
+            responses[i].status = BATCH_STATUS_INVALID;
+            continue;
+        }
+        std::string_view imsi(digits, imsi_key_to_digits(request.imsi_key, digits));
+        logger_->info("Получен IMSI: {} от {}", imsi, source);
+        responses[i].status = config->is_blacklisted(request.imsi_key) ? BATCH_STATUS_REJECTED : BATCH_STATUS_CREATED;
+    }
+
+    log_span.finish();
+
+    {
+        TraceSpan lock_span(TRACE_STAGE_LOCK_WAIT);
+        std::lock_guard<std::mutex> lock(session_mutex_);
+        lock_span.finish();
+        TraceSpan session_span(TRACE_STAGE_SESSION);
+        time_t now = clock_();
+        for (size_t i = 0; i < count; ++i) {
+            uint64_t key = requests[i].imsi_key;
+            if (responses[i].status == BATCH_STATUS_CREATED) {
+                if (sessions_.find(key) == sessions_.end()) {
+                    sessions_.emplace(key, Session(now));
+                    track_expiry(key, now);
+                    if (listener_) listener_->on_session_created(key, now);
+                    std::string_view imsi(digits, imsi_key_to_digits(key, digits));
+                    logger_->info("Сессия создана для IMSI: {}", imsi);
+                }
+            } else if (responses[i].status == BATCH_STATUS_REJECTED) {
+                std::string_view imsi(digits, imsi_key_to_digits(key, digits));
+                logger_->warn("IMSI {} в черном списке", imsi);
+            }
+        }
+    }
+
+    TraceSpan cdr_span(TRACE_STAGE_CDR);
+    for (size_t i = 0; i < count; ++i) {
+        if (responses[i].status != BATCH_STATUS_INVALID) {
+            write_cdr(requests[i].imsi_key, batch_status_name(responses[i].status), false);
+        }
+    }
+    cdr_->flush();
+    return count;
+}
+
+uint8_t PgwEngine::process(uint64_t imsi_key, const char* source) {
+    Request request{0, imsi_key};
+    Response response{0, BATCH_STATUS_INVALID};
+    process_batch(Span<const Request>(&request, 1), Span<Response>(&response, 1), source);
+    return response.status;
+}
+
+bool PgwEngine::is_active(uint64_t imsi_key) {
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    auto it = sessions_.find(imsi_key);
+    return it != sessions_.end() && it->second.active;
+}
+
+size_t PgwEngine::session_count() {
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    return sessions_.size();
+}
+
+size_t PgwEngine::expire_sessions() {
+    char digits[IMSI_MAX_DIGITS + 1];
+    size_t removed = 0;
+    uint32_t timeout = config_->current()->config.session_timeout_sec;
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    time_t now = clock_();
+    while (!expiry_.empty() && difftime(now, expiry_.front().start_time) > timeout) {
+        SessionRecord record = expiry_.front();
+        std::pop_heap(expiry_.begin(), expiry_.end(), starts_later);
+        expiry_.pop_back();
+        auto it = sessions_.find(record.imsi_key);
+        if (it == sessions_.end() || it->second.start_time != record.start_time || !it->second.active) continue;
+        write_cdr(it->first, "timeout", true);
+        imsi_key_to_digits(it->first, digits);
+        logger_->info("Сессия для IMSI {} удалена по тайм-ауту", digits);
+        if (listener_) listener_->on_session_removed(it->first);
+        sessions_.erase(it);
+        ++removed;
+    }
+    return removed;
+}
+
+size_t PgwEngine::drain(size_t max_sessions) {
+    char digits[IMSI_MAX_DIGITS + 1];
+    size_t removed = 0;
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    auto it = sessions_.begin();
+    for (; removed < max_sessions && it != sessions_.end(); ++removed) {
+        write_cdr(it->first, "shutdown", true);
+        imsi_key_to_digits(it->first, digits);
+        logger_->info("Сессия для IMSI {} удалена при завершении", digits);
+        if (listener_) listener_->on_session_removed(it->first);
+        it = sessions_.erase(it);
+    }
+    return removed;
+}
+
+void PgwEngine::clear() {
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    sessions_.clear();
+    expiry_.clear();
+}
+
+size_t PgwEngine::adopt_sessions(Span<const SessionRecord> records) {
+    size_t adopted = 0;
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    for (const SessionRecord& record : records) {
+        if (sessions_.emplace(record.imsi_key, Session(record.start_time)).second) {
+            track_expiry(record.imsi_key, record.start_time);
+            if (listener_) listener_->on_session_created(record.imsi_key, record.start_time);
+            ++adopted;
+        }
+    }
+    return adopted;
+}
+
+size_t PgwEngine::extract_sessions(Span<const uint64_t> imsi_keys, std::vector<SessionRecord>& out) {
+    size_t extracted = 0;
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    for (uint64_t key : imsi_keys) {
+        auto it = sessions_.find(key);
+        if (it == sessions_.end()) continue;
+        out.push_back({it->first, it->second.start_time});
+        sessions_.erase(it);
+        ++extracted;
+    }
+    return extracted;
+}
+
+void PgwEngine::snapshot_sessions(std::vector<SessionRecord>& out) {
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    out.reserve(out.size() + sessions_.size());
+    for (const auto& entry : sessions_) {
+        out.push_back({entry.first, entry.second.start_time});
+    }
+}
+
+void PgwEngine::set_session_listener(SessionListener* listener) {
+    std::lock_guard<std::mutex> lock(session_mutex_);
+    listener_ = listener;
+}
@@ -0,0 +1,114 @@
+#ifndef PGW_ENGINE_H
+#define PGW_ENGINE_H
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "cdr_sink.h"
+#include "config_store.h"
+#include "span.h"
+#include "../Configs/pgw_server_config.h"
+#include "../Utils/batch_protocol.h"
+#include "spdlog/spdlog.h"
+
+#define SESSIONS_RESERVE 65536
+
+struct Session {
+    time_t start_time;
+    bool active;
+    explicit Session(time_t start) : start_time(start), active(true) {}
+};
+
+struct Request {
+    uint32_t id;
+    uint64_t imsi_key; // imsi_key_from_bcd / imsi_key_from_string
+};
+
+struct Response {
+    uint32_t id;
+    uint8_t status; // BatchStatus
+};
+
+using EngineClock = std::function<time_t()>;
+
+// Уведомления о жизненном цикле сессий; вызываются под блокировкой таблицы сессий,
+// поэтому реализация не должна обращаться к движку и должна быть быстрой
+class SessionListener {
+public:
+    virtual ~SessionListener() = default;
+    virtual void on_session_created(uint64_t imsi_key, time_t start_time) = 0;
+    virtual void on_session_removed(uint64_t imsi_key) = 0;
+};
+
+struct SessionRecord {
+    uint64_t imsi_key;
+    time_t start_time;
+};
+
+// Логика PGW без сети: сессии, чёрный список, CDR. Потокобезопасен.
+class PgwEngine {
+public:
+    PgwEngine(const pgw_server_config& config, std::shared_ptr<spdlog::logger> logger,
+              std::shared_ptr<CdrSink> cdr, EngineClock clock = nullptr);
+    // Конфигурация читается из store при каждой обработке, новые версии применяются без перезапуска
+    PgwEngine(std::shared_ptr<ConfigStore> store, std::shared_ptr<spdlog::logger> logger,
+              std::shared_ptr<CdrSink> cdr, EngineClock clock = nullptr);
+
+    // Обрабатывает min(requests.size(), responses.size()) запросов под одной блокировкой сессий.
+    // Для уже известных IMSI не выделяет память. source используется только в логах.
+    size_t process_batch(Span<const Request> requests, Span<Response> responses, const char* source = "local");
+
+    uint8_t process(uint64_t imsi_key, const char* source = "local");
+
+    bool is_active(uint64_t imsi_key);
+    bool is_blacklisted(uint64_t imsi_key) const;
+    size_t session_count();
+
+    // Удаляет сессии старше текущего session_timeout_sec, возвращает число удалённых.
+    // Просматривает только самые старые сессии, поэтому новый тайм-аут действует со следующего вызова.
+    size_t expire_sessions();
+
+    // Удаляет не более max_sessions сессий с CDR-событием shutdown
+    size_t drain(size_t max_sessions);
+
+    void clear();
+
+    // Принимает сессии с другого узла (передача владения, восстановление реплик) без CDR-записи
+    size_t adopt_sessions(Span<const SessionRecord> records);
+
+    // Извлекает сессии с перечисленными ключами без CDR-записи; отсутствующие ключи пропускаются
+    size_t extract_sessions(Span<const uint64_t> imsi_keys, std::vector<SessionRecord>& out);
+
+    void snapshot_sessions(std::vector<SessionRecord>& out);
+
+    // listener должен пережить движок; nullptr отключает уведомления
+    void set_session_listener(SessionListener* listener);
+
+    // Часы движка: по ним считаются тайм-ауты сессий и реплик
+    time_t now() const { return clock_(); }
+
+    // Дескриптор удерживает версию конфигурации, пока он жив
+    ConfigSnapshotPtr config() const { return config_->current(); }
+    ConfigStore& config_store() { return *config_; }
+    spdlog::logger& logger() { return *logger_; }
+
+private:
+    void write_cdr(uint64_t imsi_key, const char* event, bool flush);
+    void track_expiry(uint64_t imsi_key, time_t start_time);
+
+    std::shared_ptr<ConfigStore> config_;
+    std::shared_ptr<spdlog::logger> logger_;
+    std::shared_ptr<CdrSink> cdr_;
+    EngineClock clock_;
+    std::unordered_map<uint64_t, Session> sessions_;
+    // Куча по времени начала; записи удалённых сессий отбрасываются при извлечении
+    std::vector<SessionRecord> expiry_;
+    std::mutex session_mutex_;
+    SessionListener* listener_ = nullptr;
+};
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <cstddef>
+#include <vector>
+
+// Минимальная замена std::span для C++17
+template <typename T>
+class Span {
+public:
+    Span() = default;
+    Span(T* data, size_t size) : data_(data), size_(size) {}
+    template <typename U>
+    Span(std::vector<U>& v) : data_(v.data()), size_(v.size()) {}
+    template <typename U>
+    Span(const std::vector<U>& v) : data_(v.data()), size_(v.size()) {}
+    template <size_t N>
+    Span(T (&array)[N]) : data_(array), size_(N) {}
+
+    T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    T& operator[](size_t i) const { return data_[i]; }
+    T* begin() const { return data_; }
+    T* end() const { return data_ + size_; }
+
+private:
+    T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "trace.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+thread_local uint64_t trace_current_id = 0;
+
+namespace {
+
+// sequence — seqlock слота: 2 * index + 1, пока владелец пишет событие index, и 2 * index + 2 после записи
+struct TraceEvent {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> trace_id{0};
+    std::atomic<uint64_t> start_ns{0};
+    std::atomic<uint64_t> end_ns{0};
+    std::atomic<uint32_t> stage{0};
+};
+
+// Кольцо одного потока: пишет только владелец, читатель по sequence отбрасывает события,
+// которые перезаписывались во время копирования
+struct TraceRing {
+    TraceEvent events[TRACE_RING_CAPACITY];
+    std::atomic<uint64_t> head{0};
+    std::atomic<bool> owned{true};
+    uint32_t tid = 0;
+};
+
+std::atomic<uint32_t> sample_rate{0};
+std::atomic<uint64_t> next_trace_id{0};
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<TraceRing>> registry;
+
+// Кольцо завершившегося потока остаётся в дампе и переходит к следующему новому потоку
+struct RingHolder {
+    TraceRing* ring = nullptr;
+    ~RingHolder() {
+        if (ring) ring->owned.store(false, std::memory_order_release);
+    }
+};
+
+thread_local RingHolder ring_holder;
+
+TraceRing* acquire_ring() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (auto& ring : registry) {
+        bool expected = false;
+        if (ring->owned.compare_exchange_strong(expected, true)) return ring.get();
+    }
+    registry.push_back(std::make_unique<TraceRing>());
+    registry.back()->tid = registry.size();
+    return registry.back().get();
+}
+
+} // namespace
+
+uint64_t trace_now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* trace_stage_name(TraceStage stage) {
+    switch (stage) {
+        case TRACE_STAGE_PACKET: return "packet";
+        case TRACE_STAGE_QUEUE: return "queue";
+        case TRACE_STAGE_PARSE: return "parse";
+        case TRACE_STAGE_LOG: return "log";
+        case TRACE_STAGE_LOCK_WAIT: return "session_lock_wait";
+        case TRACE_STAGE_SESSION: return "session_update";
+        case TRACE_STAGE_CDR: return "cdr";
+        case TRACE_STAGE_SEND: return "send";
+        default: return "unknown";
+    }
+}
+
+void trace_set_sample_rate(uint32_t every_n) {
+    sample_rate.store(every_n, std::memory_order_relaxed);
+}
+
+uint32_t trace_sample_rate() {
+    return sample_rate.load(std::memory_order_relaxed);
+}
+
+uint64_t trace_sample() {
+    uint32_t rate = sample_rate.load(std::memory_order_relaxed);
+    if (rate == 0) return 0;
+    thread_local uint32_t counter = 0;
+    if (++counter < rate) return 0;
+    counter = 0;
+    return next_trace_id.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+void trace_record(uint64_t trace_id, TraceStage stage, uint64_t start_ns, uint64_t end_ns) {
+    TraceRing* ring = ring_holder.ring;
+    if (!ring) ring = ring_holder.ring = acquire_ring();
+    uint64_t index = ring->head.load(std::memory_order_relaxed);
+    TraceEvent& event = ring->events[index % TRACE_RING_CAPACITY];
+    event.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    // Нечётный sequence виден раньше любого из новых полей
+    std::atomic_thread_fence(std::memory_order_release);
+    event.trace_id.store(trace_id, std::memory_order_relaxed);
+    event.start_ns.store(start_ns, std::memory_order_relaxed);
+    event.end_ns.store(end_ns, std::memory_order_relaxed);
+    event.stage.store(stage, std::memory_order_relaxed);
+    event.sequence.store(2 * index + 2, std::memory_order_release);
+    ring->head.store(index + 1, std::memory_order_release);
+}
+
+std::string trace_dump_chrome_json() {
+    struct Copied {
+        uint64_t index, trace_id, start_ns, end_ns;
+        uint32_t stage;
+    };
+    nlohmann::json events = nlohmann::json::array();
+    std::vector<Copied> copied;
+    copied.reserve(TRACE_RING_CAPACITY);
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (const auto& ring : registry) {
+        copied.clear();
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t begin = head > TRACE_RING_CAPACITY ? head - TRACE_RING_CAPACITY : 0;
+        for (uint64_t i = begin; i < head; ++i) {
+            const TraceEvent& event = ring->events[i % TRACE_RING_CAPACITY];
+            // Слот должен содержать именно событие i, записанное до конца, и не меняться во время копирования
+            uint64_t sequence = event.sequence.load(std::memory_order_acquire);
+            if (sequence != 2 * i + 2) continue;
+            Copied copy = {i, event.trace_id.load(std::memory_order_relaxed),
+                           event.start_ns.load(std::memory_order_relaxed),
+                           event.end_ns.load(std::memory_order_relaxed),
+                           event.stage.load(std::memory_order_relaxed)};
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (event.sequence.load(std::memory_order_relaxed) != sequence) continue;
+            copied.push_back(copy);
+        }
+
+        for (const Copied& event : copied) {
+            if (event.stage >= TRACE_STAGE_COUNT) continue;
+            events.push_back({
+                {"name", trace_stage_name(static_cast<TraceStage>(event.stage))},
+                {"cat", "pgw"},
+                {"ph", "X"},
+                {"ts", event.start_ns / 1000.0},
+                {"dur", (event.end_ns - event.start_ns) / 1000.0},
+                {"pid", 1},
+                {"tid", ring->tid},
+                {"args", {{"packet", event.trace_id}}},
+            });
+        }
+    }
+    nlohmann::json trace = {{"traceEvents", events}, {"displayTimeUnit", "ns"}};
+    return trace.dump();
+}
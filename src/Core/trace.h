@@ -0,0 +1,75 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <string>
+
+#define TRACE_RING_CAPACITY 4096 // слотов на поток; старые события перезаписываются
+
+// Этапы обработки пакета в выборочной трассировке
+enum TraceStage : uint32_t {
+    TRACE_STAGE_PACKET = 0, // вся обработка в рабочем потоке
+    TRACE_STAGE_QUEUE,      // от recvfrom до извлечения из очереди
+    TRACE_STAGE_PARSE,
+    TRACE_STAGE_LOG,        // разбор IMSI, проверка черного списка и логирование приёма
+    TRACE_STAGE_LOCK_WAIT,  // ожидание session_mutex
+    TRACE_STAGE_SESSION,    // обновление таблицы сессий под блокировкой
+    TRACE_STAGE_CDR,
+    TRACE_STAGE_SEND,
+    TRACE_STAGE_COUNT
+};
+
+// Идентификатор трассируемого пакета в текущем потоке, 0 — пакет не трассируется
+extern thread_local uint64_t trace_current_id;
+
+uint64_t trace_now_ns();
+const char* trace_stage_name(TraceStage stage);
+
+// Трассируется каждый every_n-й пакет; 0 выключает трассировку (проверка — одно атомарное чтение)
+void trace_set_sample_rate(uint32_t every_n);
+uint32_t trace_sample_rate();
+
+// Решение о выборке для очередного пакета: идентификатор трассы или 0
+uint64_t trace_sample();
+
+// Запись в кольцевой буфер текущего потока; буфер создаётся при первой записи потока
+void trace_record(uint64_t trace_id, TraceStage stage, uint64_t start_ns, uint64_t end_ns);
+
+// События всех потоков в формате Chrome trace (chrome://tracing, Perfetto)
+std::string trace_dump_chrome_json();
+
+// Привязывает пакет к текущему потоку на время обработки
+class TraceScope {
+public:
+    explicit TraceScope(uint64_t trace_id) : previous_(trace_current_id) { trace_current_id = trace_id; }
+    ~TraceScope() { trace_current_id = previous_; }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    uint64_t previous_;
+};
+
+// Интервал этапа; без трассировки стоит одного чтения thread_local
+class TraceSpan {
+public:
+    explicit TraceSpan(TraceStage stage) : trace_id_(trace_current_id), stage_(stage) {
+        if (trace_id_) start_ns_ = trace_now_ns();
+    }
+    ~TraceSpan() { finish(); }
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    void finish() {
+        if (!trace_id_) return;
+        trace_record(trace_id_, stage_, start_ns_, trace_now_ns());
+        trace_id_ = 0;
+    }
+
+private:
+    uint64_t trace_id_;
+    TraceStage stage_;
+    uint64_t start_ns_ = 0;
+};
+
+#endif
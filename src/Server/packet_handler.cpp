@@ -0,0 +1,46 @@
+#include "packet_handler.h"
+#include "../Utils/utils.h"
+#include "../Utils/batch_protocol.h"
+#include "trace.h"
+
+const char* handle_packet(PgwEngine& engine, const Packet& packet) {
+    char addr[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &packet.client_addr.sin_addr, addr, sizeof(addr));
+
+    TraceSpan parse_span(TRACE_STAGE_PARSE);
+    uint64_t key = imsi_key_from_bcd(reinterpret_cast<const uint8_t*>(packet.data), packet.bytes_received);
+    parse_span.finish();
+    if (key == IMSI_KEY_INVALID) {
+        engine.logger().warn("Некорректный BCD-IMSI длиной {} от {}", packet.bytes_received, addr);
+        return "rejected";
+    }
+    return engine.process(key, addr) == BATCH_STATUS_CREATED ? "created" : "rejected";
+}
+
+size_t handle_batch_packet(PgwEngine& engine, const Packet& packet, uint8_t* response, size_t response_size) {
+    char addr[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &packet.client_addr.sin_addr, addr, sizeof(addr));
+
+    TraceSpan parse_span(TRACE_STAGE_PARSE);
+    BatchRequestView view;
+    BatchParseResult result = view.parse(reinterpret_cast<const uint8_t*>(packet.data), packet.bytes_received);
+    if (result != BATCH_PARSE_OK) {
+        engine.logger().warn("Некорректный пакетный запрос от {}: {}", addr, batch_parse_error(result));
+        return 0;
+    }
+
+    Request requests[BATCH_MAX_ENTRIES];
+    Response responses[BATCH_MAX_ENTRIES];
+    uint8_t statuses[BATCH_MAX_ENTRIES];
+    size_t count = view.count();
+    for (size_t i = 0; i < count; ++i) {
+        requests[i].id = view.request_id(i);
+        requests[i].imsi_key = imsi_key_from_bcd(view.bcd(i), IMSI_BCD_MAX_BYTES);
+    }
+    parse_span.finish();
+    engine.process_batch(Span<const Request>(requests, count), Span<Response>(responses, count), addr);
+    for (size_t i = 0; i < count; ++i) {
+        statuses[i] = responses[i].status;
+    }
+    return encode_batch_response(view.batch_id(), statuses, count, response, response_size);
+}
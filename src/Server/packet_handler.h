@@ -0,0 +1,15 @@
+#ifndef PACKET_HANDLER_H
+#define PACKET_HANDLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "packet_queue.h"
+#include "pgw_engine.h"
+
+// Датаграмма старого формата: один BCD-IMSI, ответ "created" / "rejected"
+const char* handle_packet(PgwEngine& engine, const Packet& packet);
+
+// Пакетный запрос (batch_protocol.h): возвращает длину ответа в response или 0 для некорректной датаграммы
+size_t handle_batch_packet(PgwEngine& engine, const Packet& packet, uint8_t* response, size_t response_size);
+
+#endif
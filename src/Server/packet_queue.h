@@ -0,0 +1,64 @@
+#ifndef PACKET_QUEUE_H
+#define PACKET_QUEUE_H
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#define BUFFER_SIZE 4096
+#define QUEUE_CAPACITY 256        // наименьшая очередь одного рабочего потока
+#define QUEUE_TOTAL_CAPACITY 1024 // суммарная ёмкость очередей при min_workers, как у прежней общей очереди
+
+struct Packet {
+    char data[BUFFER_SIZE];
+    struct sockaddr_in client_addr;
+    socklen_t client_len;
+    int bytes_received;
+    uint64_t trace_id = 0;    // ненулевой у пакетов, попавших в выборку трассировки
+    uint64_t received_ns = 0; // trace_now_ns() при приёме: время в очереди для трассировки и масштабирования
+    int forwarded_from = -1;  // узел кластера, переславший запрос; ответ уходит ему, а не клиенту
+};
+
+// Кольцевой буфер фиксированной ёмкости: слоты выделяются один раз при создании.
+// У каждого рабочего потока своя очередь: пишет поток приёма, читают владелец и крадущие работу потоки.
+class PacketQueue {
+public:
+    explicit PacketQueue(size_t capacity = QUEUE_CAPACITY) : slots_(capacity) {}
+
+    bool push(const Packet& packet) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_ == slots_.size()) return false;
+        slots_[tail_] = packet;
+        tail_ = (tail_ + 1) % slots_.size();
+        ++count_;
+        size_.fetch_add(1);
+        return true;
+    }
+
+    bool pop(Packet& packet) {
+        // Пустую очередь проверяем без блокировки — так опрашиваются чужие очереди при краже работы
+        if (size_.load() == 0) return false;
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (count_ == 0) return false;
+        packet = slots_[head_];
+        head_ = (head_ + 1) % slots_.size();
+        --count_;
+        size_.fetch_sub(1);
+        return true;
+    }
+
+    size_t size() const { return size_.load(); }
+
+private:
+    std::vector<Packet> slots_;
+    size_t head_ = 0;
+    size_t tail_ = 0;
+    size_t count_ = 0;
+    std::atomic<size_t> size_{0};
+    std::mutex mutex_;
+};
+
+#endif
@@ -5,111 +5,208 @@
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <csignal>
 #include <thread>
 #include <mutex>
-#include <queue>
-#include <condition_variable>
 #include <chrono>
-#include <fstream>
 #include "../Utils/utils.h"
+#include "../Utils/batch_protocol.h"
+#include "packet_handler.h"
+#include "packet_queue.h"
+#include "worker_pool.h"
+#include "pgw_engine.h"
+#include "config_store.h"
+#include "trace.h"
+#include "shm_channel.h"
+#include "cluster_node.h"
+#include "capture_file.h"
 #include <nlohmann/json.hpp>
 #include "spdlog/spdlog.h"
 #include <httplib.h>
 #include "spdlog/sinks/basic_file_sink.h"
 
-#define BUFFER_SIZE 1024
-#define NUM_THREADS 4
-
-struct Packet {
-    char data[BUFFER_SIZE];
-    struct sockaddr_in client_addr;
-    socklen_t client_len;
-    int bytes_received;
-};
-
-struct Session {
-    time_t start_time;
-    bool active;
-    Session() : start_time(time(nullptr)), active(true) {}
-};
-
-std::queue<Packet> packet_queue;
-std::mutex queue_mutex, session_mutex;
-std::condition_variable cv;
-std::map<std::string, Session> sessions;
+#define SHM_INGEST_BATCH 64
+#define SIGNAL_POLL_MS 200
+
+std::string config_path;
+std::shared_ptr<ConfigStore> config_store;
+std::mutex reload_mutex;
+std::unique_ptr<WorkerPool> worker_pool;
+std::unique_ptr<PgwEngine> engine;
+std::shared_ptr<FileCdrSink> cdr_sink;
+ShmChannel shm_channel;
+std::unique_ptr<ClusterNode> cluster;
+CaptureWriter capture;
 std::atomic<bool> shutdown_flag(false);
 std::shared_ptr<spdlog::logger> logger;
 
-void worker_thread(int sockfd, const pgw_server_config& config) {
+void handle_forwarded(const Packet& packet);
+
+void handle_datagram(int sockfd, const Packet& packet) {
+    TraceScope trace(packet.trace_id);
+    if (packet.trace_id) trace_record(packet.trace_id, TRACE_STAGE_QUEUE, packet.received_ns, trace_now_ns());
+    TraceSpan packet_span(TRACE_STAGE_PACKET);
+    if (packet.forwarded_from >= 0) {
+        handle_forwarded(packet);
+        return;
+    }
+    if (cluster && cluster->route(reinterpret_cast<const uint8_t*>(packet.data), packet.bytes_received,
+                                  packet.client_addr)) {
+        return;
+    }
+    if (is_batch_datagram(reinterpret_cast<const uint8_t*>(packet.data), packet.bytes_received)) {
+        uint8_t batch_response[BATCH_MAX_RESPONSE_SIZE];
+        size_t len = handle_batch_packet(*engine, packet, batch_response, sizeof(batch_response));
+        if (len > 0) {
+            TraceSpan send_span(TRACE_STAGE_SEND);
+            sendto(sockfd, batch_response, len, 0, (struct sockaddr*)&packet.client_addr, packet.client_len);
+        }
+        return;
+    }
+    const char* response = handle_packet(*engine, packet);
+    TraceSpan send_span(TRACE_STAGE_SEND);
+    sendto(sockfd, response, strlen(response), 0, (struct sockaddr*)&packet.client_addr, packet.client_len);
+}
+
+void shm_ingest_thread(ShmChannel& channel) {
+    uint32_t slots[SHM_INGEST_BATCH];
+    Request requests[SHM_INGEST_BATCH];
+    Response responses[SHM_INGEST_BATCH];
+    uint64_t rejected = 0;
     while (!shutdown_flag) {
-        Packet packet;
-        {
-            std::unique_lock<std::mutex> lock(queue_mutex);
-            cv.wait(lock, [] { return !packet_queue.empty() || shutdown_flag; });
-            if (shutdown_flag && packet_queue.empty()) break;
-            if (!packet_queue.empty()) {
-                packet = packet_queue.front();
-                packet_queue.pop();
-            } else continue;
+        size_t count = channel.poll(slots, SHM_INGEST_BATCH);
+        if (channel.rejected() != rejected) {
+            logger->error("Отброшено запросов с номером слота вне канала: {}", channel.rejected() - rejected);
+            rejected = channel.rejected();
         }
+        if (count == 0) {
+            channel.wait_for_work(100);
+            continue;
+        }
+        TraceScope trace(trace_sample());
+        TraceSpan batch_span(TRACE_STAGE_PACKET);
+        for (size_t i = 0; i < count; ++i) {
+            const ShmSlot& slot = channel.slot(slots[i]);
+            requests[i].id = slot.request_id;
+            requests[i].imsi_key = imsi_key_from_bcd(slot.bcd, SHM_BCD_SIZE);
+        }
+        engine->process_batch(Span<const Request>(requests, count), Span<Response>(responses, count), "shm");
+        for (size_t i = 0; i < count; ++i) {
+            channel.complete(slots[i], responses[i].status);
+        }
+    }
+    logger->info("Поток приёма из разделяемой памяти завершён");
+}
+
+// Запрос, пересланный другим узлом кластера, ставится в очередь рабочих потоков наравне с пакетами клиентов
+bool enqueue_forwarded(const uint8_t* data, size_t len, const struct sockaddr_in& client, int sender) {
+    Packet packet;
+    if (len >= BUFFER_SIZE) return true;
+    memcpy(packet.data, data, len);
+    packet.bytes_received = static_cast<int>(len);
+    packet.client_addr = client;
+    packet.client_len = sizeof(client);
+    packet.received_ns = trace_now_ns();
+    packet.forwarded_from = sender;
+    return worker_pool->submit(packet);
+}
 
-        std::vector<uint8_t> bcd_imsi(packet.data, packet.data + packet.bytes_received);
-        std::string imsi = decode_bcd(bcd_imsi);
-        logger->info("Получен IMSI: {} от {}", imsi, inet_ntoa(packet.client_addr.sin_addr));
+// Обработка пересланного запроса в рабочем потоке; ответ возвращается переславшему узлу
+void handle_forwarded(const Packet& packet) {
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(packet.data);
+    size_t len = packet.bytes_received;
+    if (is_batch_datagram(data, len)) {
+        uint8_t response[BATCH_MAX_RESPONSE_SIZE];
+        size_t response_len = handle_batch_packet(*engine, packet, response, sizeof(response));
+        cluster->reply(packet.forwarded_from, packet.client_addr, response, response_len);
+        return;
+    }
+    const char* status = handle_packet(*engine, packet);
+    cluster->reply(packet.forwarded_from, packet.client_addr, reinterpret_cast<const uint8_t*>(status), strlen(status));
+}
 
-        bool is_blacklisted = std::find(config.blacklist.begin(), config.blacklist.end(), imsi) != config.blacklist.end();
-        const char* response = is_blacklisted ? "rejected" : "created";
+// std::stoll принимает "12abc" как 12, поэтому параметр должен разбираться целиком
+int64_t parse_whole_int64(const std::string& text) {
+    size_t pos = 0;
+    int64_t value = std::stoll(text, &pos);
+    if (pos != text.size()) throw std::invalid_argument(text);
+    return value;
+}
 
-        {
-            std::lock_guard<std::mutex> lock(session_mutex);
-            if (!is_blacklisted && sessions.find(imsi) == sessions.end()) {
-                sessions[imsi] = Session();
-                logger->info("Сессия создана для IMSI: {}", imsi);
-            } else if (is_blacklisted) {
-                logger->warn("IMSI {} в черном списке", imsi);
-            }
-        }
+void session_timeout_thread() {
+    while (!shutdown_flag) {
+        std::this_thread::sleep_for(std::chrono::seconds(1)); // Уменьшено с 5 до 1 секунды
+        engine->expire_sessions();
+    }
+    logger->info("Поток тайм-аута сессий завершён");
+}
 
-        {
-            std::ofstream cdr_file(config.cdr_file, std::ios::app);
-            if (cdr_file.is_open()) {
-                cdr_file << imsi << ", " << (is_blacklisted ? "rejected" : "created") << "\n";
-                cdr_file.flush();
-            } else {
-                logger->error("Не удалось открыть CDR-файл: {}", config.cdr_file);
-            }
-        }
+// Адреса, порты, файлы, разделяемая память и кластер задаются только при запуске:
+// их изменения в файле не применяются, а остаются прежними в новой версии конфигурации
+static void keep_restart_only_fields(const pgw_server_config& current, pgw_server_config& next) {
+    auto keep = [](const char* name, auto& next_value, const auto& current_value) {
+        if (next_value == current_value) return;
+        logger->warn("Параметр {} изменится только после перезапуска", name);
+        next_value = current_value;
+    };
+    keep("udp_ip", next.udp_ip, current.udp_ip);
+    keep("udp_port", next.udp_port, current.udp_port);
+    keep("http_port", next.http_port, current.http_port);
+    keep("log_file", next.log_file, current.log_file);
+    keep("cdr_file", next.cdr_file, current.cdr_file);
+    keep("cdr_rotate_bytes", next.cdr_rotate_bytes, current.cdr_rotate_bytes);
+    keep("cdr_index_capacity", next.cdr_index_capacity, current.cdr_index_capacity);
+    keep("shm_name", next.shm_name, current.shm_name);
+    keep("shm_slots", next.shm_slots, current.shm_slots);
+    keep("capture_file", next.capture_file, current.capture_file);
+    keep("cluster.node_id", next.cluster_node_id, current.cluster_node_id);
+    keep("cluster.virtual_nodes", next.cluster_virtual_nodes, current.cluster_virtual_nodes);
+    keep("cluster.heartbeat_ms", next.cluster_heartbeat_ms, current.cluster_heartbeat_ms);
+    keep("cluster.failure_timeout_ms", next.cluster_failure_timeout_ms, current.cluster_failure_timeout_ms);
+    bool nodes_changed = next.cluster_nodes.size() != current.cluster_nodes.size();
+    for (size_t i = 0; !nodes_changed && i < next.cluster_nodes.size(); ++i) {
+        const auto& a = next.cluster_nodes[i];
+        const auto& b = current.cluster_nodes[i];
+        nodes_changed = a.id != b.id || a.ip != b.ip || a.port != b.port;
+    }
+    if (nodes_changed) {
+        logger->warn("Параметр cluster.nodes изменится только после перезапуска");
+        next.cluster_nodes = current.cluster_nodes;
+    }
+}
 
-        sendto(sockfd, response, strlen(response), 0, (struct sockaddr*)&packet.client_addr, packet.client_len);
+// Перечитывает файл конфигурации и публикует новую версию; при ошибке остаётся прежняя
+bool reload_config() {
+    std::lock_guard<std::mutex> lock(reload_mutex);
+    pgw_server_config next = load_pgw_server_config(config_path);
+    if (!validate_pgw_server_config(next)) {
+        logger->error("Конфигурация {} не прошла проверку, используется версия {}", config_path,
+                      config_store->version());
+        return false;
     }
-    logger->info("Рабочий поток завершён");
+    keep_restart_only_fields(config_store->current()->config, next);
+    ConfigSnapshotPtr snapshot = config_store->publish(next);
+    logger->set_level(spdlog::level::from_str(next.log_level));
+    trace_set_sample_rate(next.trace_sample_rate);
+    worker_pool->set_limits(next.workers_min, next.workers_max);
+    logger->info("Конфигурация перезагружена, версия {}", snapshot->version);
+    return true;
 }
 
-void session_timeout_thread(const pgw_server_config& config) {
+// SIGHUP заблокирован во всех потоках и принимается только здесь
+void signal_thread(sigset_t signals) {
+    struct timespec timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_nsec = SIGNAL_POLL_MS * 1000000L;
     while (!shutdown_flag) {
-        std::this_thread::sleep_for(std::chrono::seconds(1)); // Уменьшено с 5 до 1 секунды
-        std::lock_guard<std::mutex> lock(session_mutex);
-        auto now = time(nullptr);
-        for (auto it = sessions.begin(); it != sessions.end();) {
-            if (difftime(now, it->second.start_time) > config.session_timeout_sec && it->second.active) {
-                std::ofstream cdr_file(config.cdr_file, std::ios::app);
-                if (cdr_file.is_open()) {
-                    cdr_file << it->first << ", timeout\n";
-                    cdr_file.flush();
-                } else {
-                    logger->error("Не удалось открыть CDR-файл: {}", config.cdr_file);
-                }
-                logger->info("Сессия для IMSI {} удалена по тайм-ауту", it->first);
-                it = sessions.erase(it);
-            } else {
-                ++it;
-            }
+        if (sigtimedwait(&signals, nullptr, &timeout) == SIGHUP) {
+            logger->info("Получен SIGHUP, перезагрузка конфигурации {}", config_path);
+            reload_config();
         }
     }
-    logger->info("Поток тайм-аута сессий завершён");
 }
 
-void http_server(const pgw_server_config& config) {
+void http_server() {
     httplib::Server svr;
     svr.Get("/check_subscriber", [&](const httplib::Request& req, httplib::Response& res) {
         std::string imsi = req.get_param_value("imsi");
@@ -120,44 +217,89 @@ void http_server(const pgw_server_config& config) {
             return;
         }
         logger->info("HTTP /check_subscriber: запрос для IMSI {}", imsi);
-        std::lock_guard<std::mutex> lock(session_mutex);
-        res.set_content(sessions.find(imsi) != sessions.end() && sessions[imsi].active ? "active" : "not active", "text/plain");
+        res.set_content(engine->is_active(imsi_key_from_string(imsi)) ? "active" : "not active", "text/plain");
+    });
+
+    svr.Get("/cdr", [&](const httplib::Request& req, httplib::Response& res) {
+        CdrQuery query;
+        try {
+            if (req.has_param("imsi")) {
+                query.imsi_key = imsi_key_from_string(req.get_param_value("imsi"));
+                if (query.imsi_key == IMSI_KEY_INVALID) throw std::invalid_argument("imsi");
+            }
+            if (req.has_param("from")) query.from = parse_whole_int64(req.get_param_value("from"));
+            if (req.has_param("to")) query.to = parse_whole_int64(req.get_param_value("to"));
+            if (req.has_param("limit")) {
+                int64_t limit = parse_whole_int64(req.get_param_value("limit"));
+                if (limit < 0) throw std::invalid_argument("limit");
+                query.limit = static_cast<size_t>(limit);
+            }
+        } catch (const std::exception&) {
+            logger->error("HTTP /cdr: некорректные параметры запроса");
+            res.set_content("Ошибка: некорректные параметры imsi/from/to/limit", "text/plain");
+            res.status = 400;
+            return;
+        }
+        if (query.limit == 0 || query.limit > CDR_QUERY_LIMIT_MAX) query.limit = CDR_QUERY_LIMIT_MAX;
+        logger->info("HTTP /cdr: запрос для IMSI {} с {} по {}", req.get_param_value("imsi"), query.from, query.to);
+
+        std::vector<std::string> records;
+        cdr_sink->query(query, records);
+        std::string body;
+        for (const auto& record : records) {
+            body += record;
+            body += '\n';
+        }
+        res.set_content(body, "text/plain");
+    });
+
+    svr.Get("/debug/trace", [&](const httplib::Request&, httplib::Response& res) {
+        logger->info("HTTP /debug/trace: выгрузка трассировки, выборка 1 из {}", trace_sample_rate());
+        res.set_content(trace_dump_chrome_json(), "application/json");
+    });
+
+    svr.Get("/workers", [&](const httplib::Request&, httplib::Response& res) {
+        nlohmann::json workers = nlohmann::json::array();
+        for (const auto& worker : worker_pool->stats()) {
+            workers.push_back({{"id", worker.id}, {"active", worker.active}, {"processed", worker.processed},
+                               {"stolen", worker.stolen}, {"utilization", worker.utilization},
+                               {"queue_depth", worker.queue_depth}});
+        }
+        nlohmann::json body = {{"active", worker_pool->active_workers()}, {"min", worker_pool->min_workers()},
+                               {"max", worker_pool->max_workers()}, {"workers", workers}};
+        res.set_content(body.dump(), "application/json");
+    });
+
+    svr.Post("/config/reload", [&](const httplib::Request&, httplib::Response& res) {
+        logger->info("HTTP /config/reload: перезагрузка конфигурации {}", config_path);
+        bool reloaded = reload_config();
+        nlohmann::json body = {{"reloaded", reloaded}, {"version", config_store->version()}};
+        res.set_content(body.dump(), "application/json");
+        res.status = reloaded ? 200 : 400;
     });
 
     svr.Get("/stop", [&](const httplib::Request& req, httplib::Response& res) {
         logger->info("HTTP /stop: Запрос на завершение сервера");
         shutdown_flag = true;
-        cv.notify_all();
         res.set_content("Shutting down...", "text/plain");
         res.status = 200;
 
         auto start = std::chrono::steady_clock::now();
-        while (!sessions.empty() && std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start).count() < 30) {
-            std::lock_guard<std::mutex> lock(session_mutex);
-            size_t to_remove = std::min(static_cast<size_t>(config.graceful_shutdown_rate), sessions.size());
-            auto it = sessions.begin();
-            for (size_t i = 0; i < to_remove && it != sessions.end(); ++i) {
-                std::ofstream cdr_file(config.cdr_file, std::ios::app);
-                if (cdr_file.is_open()) {
-                    cdr_file << it->first << ", shutdown\n";
-                    cdr_file.flush();
-                } else {
-                    logger->error("Не удалось открыть CDR-файл: {}", config.cdr_file);
-                }
-                logger->info("Сессия для IMSI {} удалена при завершении", it->first);
-                it = sessions.erase(it);
-            }
+        while (engine->session_count() > 0 &&
+               std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start).count() < 30) {
+            engine->drain(config_store->current()->config.graceful_shutdown_rate);
             std::this_thread::sleep_for(std::chrono::seconds(1));
         }
-        sessions.clear();
+        engine->clear();
         svr.stop();
         logger->info("HTTP-сервер остановлен");
     });
 
-    logger->info("Запуск HTTP-сервера на 0.0.0.0:{}", config.http_port);
-    if (!svr.listen("0.0.0.0", config.http_port)) {
-        logger->error("Не удалось запустить HTTP-сервер на порту {}", config.http_port);
-        std::cerr << "Ошибка запуска HTTP-сервера на порту " << config.http_port << std::endl;
+    uint32_t http_port = config_store->current()->config.http_port;
+    logger->info("Запуск HTTP-сервера на 0.0.0.0:{}", http_port);
+    if (!svr.listen("0.0.0.0", http_port)) {
+        logger->error("Не удалось запустить HTTP-сервер на порту {}", http_port);
+        std::cerr << "Ошибка запуска HTTP-сервера на порту " << http_port << std::endl;
     }
 }
 
@@ -166,9 +308,15 @@ int main(int argc, char* argv[]) {
         std::cerr << "Usage: " << argv[0] << " <config.json>" << std::endl;
         return 1;
     }
-    std::string config_file = argv[1];
+    config_path = argv[1];
 
-    auto config = load_pgw_server_config(config_file);
+    // Маска наследуется всеми потоками, поэтому SIGHUP блокируется до их создания
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGHUP);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    auto config = load_pgw_server_config(config_path);
     if (!validate_pgw_server_config(config)) {
         std::cerr << "Invalid server configuration" << std::endl;
         return 1;
@@ -188,10 +336,18 @@ int main(int argc, char* argv[]) {
     logger->flush_on(spdlog::level::info);
     logger->info("Сервер запущен");
 
+    cdr_sink = std::make_shared<FileCdrSink>();
+    if (!cdr_sink->open(config.cdr_file, config.cdr_rotate_bytes, config.cdr_index_capacity)) {
+        logger->error("Не удалось открыть CDR-файл: {}", config.cdr_file);
+        std::cerr << "Не удалось открыть CDR-файл: " << config.cdr_file << std::endl;
+        return 1;
+    }
+    config_store = std::make_shared<ConfigStore>(config, logger);
+    engine = std::make_unique<PgwEngine>(config_store, logger, cdr_sink);
+    trace_set_sample_rate(config.trace_sample_rate);
+
     int sockfd;
-    struct sockaddr_in server_addr, client_addr;
-    socklen_t client_len = sizeof(client_addr);
-    char buffer[BUFFER_SIZE];
+    struct sockaddr_in server_addr;
 
     sockfd = socket(AF_INET, SOCK_DGRAM, 0);
     if (sockfd < 0) {
@@ -224,17 +380,52 @@ int main(int argc, char* argv[]) {
 
     std::cout << "UDP-сервер запущен на " << config.udp_ip << ":" << config.udp_port << "..." << std::endl;
 
-    std::vector<std::thread> threads;
-    for (int i = 0; i < NUM_THREADS; ++i) {
-        threads.emplace_back(worker_thread, sockfd, config);
+    // Пул запускается раньше узла кластера: поток кластера ставит в него пересланные запросы
+    WorkerPoolOptions pool_options;
+    pool_options.min_workers = config.workers_min;
+    pool_options.max_workers = config.workers_max;
+    worker_pool = std::make_unique<WorkerPool>(pool_options, [sockfd](const Packet& packet) {
+        handle_datagram(sockfd, packet);
+    }, logger);
+    worker_pool->start();
+
+    if (!config.cluster_node_id.empty()) {
+        cluster = std::make_unique<ClusterNode>(config, *engine, logger);
+        engine->set_session_listener(cluster.get());
+        if (!cluster->start(sockfd, enqueue_forwarded)) {
+            logger->error("Не удалось запустить узел кластера {}", config.cluster_node_id);
+            std::cerr << "Не удалось запустить узел кластера " << config.cluster_node_id << std::endl;
+            worker_pool->stop();
+            close(sockfd);
+            return 1;
+        }
     }
 
-    std::thread timeout_thread(session_timeout_thread, config);
-    std::thread http_thread(http_server, config);
+    std::thread shm_thread;
+    if (!config.shm_name.empty()) {
+        if (shm_channel.create(config.shm_name, config.shm_slots)) {
+            logger->info("Канал в разделяемой памяти {} создан, слотов: {}", config.shm_name, config.shm_slots);
+            shm_thread = std::thread(shm_ingest_thread, std::ref(shm_channel));
+        } else {
+            logger->error("Не удалось создать канал в разделяемой памяти {}: {}", config.shm_name, strerror(errno));
+        }
+    }
+
+    if (!config.capture_file.empty()) {
+        if (capture.open(config.capture_file)) {
+            logger->info("Захват трафика в файл {}", config.capture_file);
+        } else {
+            logger->error("Не удалось открыть файл захвата: {}", config.capture_file);
+        }
+    }
 
+    std::thread timeout_thread(session_timeout_thread);
+    std::thread http_thread(http_server);
+    std::thread reload_thread(signal_thread, signals);
+
+    Packet packet;
     while (!shutdown_flag) {
-        Packet packet;
-        packet.client_len = sizeof(client_addr);
+        packet.client_len = sizeof(packet.client_addr);
         packet.bytes_received = recvfrom(sockfd, packet.data, BUFFER_SIZE - 1, 0,
                                         (struct sockaddr*)&packet.client_addr, &packet.client_len);
         if (packet.bytes_received < 0) {
@@ -245,22 +436,34 @@ int main(int argc, char* argv[]) {
             std::cerr << "Ошибка приема данных" << std::endl;
             continue;
         }
+        if (capture.is_open()) {
+            capture.append(capture_now_ns(), packet.client_addr, packet.data, packet.bytes_received);
+        }
+        packet.received_ns = trace_now_ns();
+        packet.trace_id = trace_sample();
 
-        {
-            std::lock_guard<std::mutex> lock(queue_mutex);
-            packet_queue.push(packet);
+        if (!worker_pool->submit(packet)) {
+            logger->warn("Очереди рабочих потоков переполнены, пакет отброшен");
         }
-        cv.notify_one();
     }
 
     logger->info("Основной цикл завершён, ожидание завершения потоков");
 
-    for (auto& thread : threads) {
-        if (thread.joinable()) thread.join();
+    worker_pool->stop();
+    if (cluster) {
+        cluster->stop();
+        engine->set_session_listener(nullptr);
     }
+    if (shm_thread.joinable()) shm_thread.join();
+    shm_channel.destroy();
     if (timeout_thread.joinable()) timeout_thread.join();
     if (http_thread.joinable()) http_thread.join();
+    if (reload_thread.joinable()) reload_thread.join();
 
+    if (capture.is_open()) {
+        capture.close();
+        logger->info("Захват трафика завершён: записано {}, отброшено {}", capture.written(), capture.dropped());
+    }
     close(sockfd);
     logger->info("Сервер завершил работу");
     logger->flush();
@@ -0,0 +1,239 @@
+#include "worker_pool.h"
+#include <algorithm>
+#include <chrono>
+#include "trace.h"
+#include "spdlog/sinks/null_sink.h"
+
+WorkerPool::WorkerPool(const WorkerPoolOptions& options, Handler handler, std::shared_ptr<spdlog::logger> logger)
+    : options_(options), handler_(std::move(handler)), logger_(std::move(logger)) {
+    if (!logger_) logger_ = std::make_shared<spdlog::logger>("worker_pool", std::make_shared<spdlog::sinks::null_sink_mt>());
+    options_.min_workers = std::max<size_t>(options_.min_workers, 1);
+    options_.max_workers = std::max(options_.max_workers, options_.min_workers);
+    // На одном ядре ожидание в цикле только отнимает время у потока приёма
+    spin_limit_ = std::thread::hardware_concurrency() > 1 ? WORKER_SPIN_ITERATIONS : 0;
+    // Пока пул не вырос, всплеск должен помещаться в очереди min_workers потоков не хуже прежней общей очереди
+    queue_capacity_ = std::max<size_t>(QUEUE_CAPACITY,
+                                       (QUEUE_TOTAL_CAPACITY + options_.min_workers - 1) / options_.min_workers);
+    for (size_t i = 0; i < options_.max_workers; ++i) {
+        workers_.push_back(std::make_unique<Worker>(queue_capacity_));
+    }
+    min_workers_ = options_.min_workers;
+    max_workers_ = options_.max_workers;
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+void WorkerPool::start() {
+    stop_ = false;
+    last_tick_ns_ = trace_now_ns();
+    for (size_t i = 0; i < min_workers_; ++i) grow();
+    scale_thread_ = std::thread(&WorkerPool::scale_loop, this);
+}
+
+void WorkerPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        if (stop_) return;
+        stop_ = true;
+    }
+    scale_cv_.notify_all();
+    if (scale_thread_.joinable()) scale_thread_.join();
+    for (auto& worker : workers_) {
+        wake(*worker);
+        if (worker->thread.joinable()) worker->thread.join();
+    }
+    std::unique_lock<std::mutex> lock(stats_mutex_);
+    join_retired(lock);
+    active_ = 0;
+}
+
+void WorkerPool::set_limits(size_t min_workers, size_t max_workers) {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    if (max_workers > workers_.size()) {
+        logger_->warn("workers_max больше {} применится только после перезапуска", workers_.size());
+        max_workers = workers_.size();
+    }
+    min_workers = std::min(std::max<size_t>(min_workers, 1), max_workers);
+    min_workers_ = min_workers;
+    max_workers_ = max_workers;
+    if (stop_ || !scale_thread_.joinable()) return;
+    while (active_ < min_workers) grow();
+    while (active_ > max_workers) shrink();
+    low_ticks_ = 0;
+}
+
+bool WorkerPool::submit(const Packet& packet) {
+    size_t active = active_.load();
+    for (size_t attempt = 0; attempt < active; ++attempt) {
+        Worker& worker = *workers_[next_.fetch_add(1, std::memory_order_relaxed) % active];
+        if (worker.queue.push(packet)) {
+            wake(worker);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::wake(Worker& worker) {
+    // parked выставляется до последней проверки очереди, а size() меняется до этого чтения,
+    // поэтому спящий поток не пропустит пакет; блокировка — только если поток действительно спит
+    if (worker.parked.load() == 0) return;
+    std::lock_guard<std::mutex> lock(worker.park_mutex);
+    worker.park_cv.notify_one();
+}
+
+void WorkerPool::worker_loop(size_t index, uint64_t generation) {
+    Worker& self = *workers_[index];
+    Packet packet;
+    size_t spins = 0;
+    while (!stop_) {
+        if (self.generation.load() != generation) {
+            // Остановленный поток не крадёт работу и дорабатывает только то, что уже было в его очереди,
+            // иначе под нагрузкой он не выйдет никогда; остальное заберут активные потоки
+            for (size_t left = self.queue.size(); left > 0 && self.queue.pop(packet); --left) run(self, packet);
+            break;
+        }
+        if (self.queue.pop(packet)) {
+            run(self, packet);
+            spins = 0;
+            continue;
+        }
+        if (steal(index, packet)) {
+            ++self.stolen;
+            run(self, packet);
+            spins = 0;
+            continue;
+        }
+        if (spins < spin_limit_) {
+            ++spins;
+            std::this_thread::yield();
+            continue;
+        }
+        park(self, generation);
+        spins = 0;
+    }
+    logger_->info("Рабочий поток {} завершён", index);
+}
+
+bool WorkerPool::steal(size_t index, Packet& packet) {
+    // Просматриваем все очереди, включая остановленных потоков: туда мог успеть попасть пакет
+    for (size_t k = 1; k < workers_.size(); ++k) {
+        if (workers_[(index + k) % workers_.size()]->queue.pop(packet)) return true;
+    }
+    return false;
+}
+
+void WorkerPool::run(Worker& worker, const Packet& packet) {
+    uint64_t start = trace_now_ns();
+    if (packet.received_ns && start > packet.received_ns) worker.wait_ns += start - packet.received_ns;
+    handler_(packet);
+    worker.busy_ns += trace_now_ns() - start;
+    ++worker.processed;
+}
+
+void WorkerPool::park(Worker& worker, uint64_t generation) {
+    std::unique_lock<std::mutex> lock(worker.park_mutex);
+    ++worker.parked;
+    if (worker.queue.size() == 0 && !stop_ && worker.generation.load() == generation) {
+        // Просыпаемся и без сигнала, чтобы забрать работу из чужих очередей
+        worker.park_cv.wait_for(lock, std::chrono::milliseconds(WORKER_PARK_MS));
+    }
+    --worker.parked;
+}
+
+void WorkerPool::scale_loop() {
+    std::unique_lock<std::mutex> lock(stats_mutex_);
+    while (!stop_) {
+        scale_cv_.wait_for(lock, std::chrono::milliseconds(options_.scale_interval_ms));
+        if (stop_) break;
+        scale();
+        join_retired(lock);
+    }
+}
+
+void WorkerPool::join_retired(std::unique_lock<std::mutex>& lock) {
+    if (retired_.empty()) return;
+    // Присоединяем без блокировки: stats() и set_limits() не должны ждать, пока поток доработает очередь
+    std::vector<std::thread> retired;
+    retired.swap(retired_);
+    lock.unlock();
+    for (auto& thread : retired) thread.join();
+    lock.lock();
+}
+
+void WorkerPool::scale() {
+    uint64_t now = trace_now_ns();
+    uint64_t interval = std::max<uint64_t>(now - last_tick_ns_, 1);
+    last_tick_ns_ = now;
+
+    size_t active = active_.load();
+    size_t depth = 0;
+    uint64_t processed = 0;
+    uint64_t wait_ns = 0;
+    double utilization = 0;
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        Worker& worker = *workers_[i];
+        uint64_t busy_total = worker.busy_ns.load();
+        uint64_t processed_total = worker.processed.load();
+        uint64_t wait_total = worker.wait_ns.load();
+        worker.utilization = std::min(1.0, double(busy_total - worker.last_busy_ns) / interval);
+        processed += processed_total - worker.last_processed;
+        wait_ns += wait_total - worker.last_wait_ns;
+        worker.last_busy_ns = busy_total;
+        worker.last_processed = processed_total;
+        worker.last_wait_ns = wait_total;
+        depth += worker.queue.size();
+        if (i < active) utilization += worker.utilization;
+    }
+    utilization /= std::max<size_t>(active, 1);
+    uint64_t average_wait_us = processed ? wait_ns / processed / 1000 : 0;
+
+    if (active < max_workers_ && (depth > active * WORKER_GROW_DEPTH || average_wait_us > WORKER_GROW_WAIT_US)) {
+        logger_->info("Очереди: {} пакетов, среднее ожидание {} мкс", depth, average_wait_us);
+        grow();
+        low_ticks_ = 0;
+    } else if (active > min_workers_ && utilization < WORKER_SHRINK_UTILIZATION) {
+        if (++low_ticks_ >= options_.shrink_ticks) {
+            shrink();
+            low_ticks_ = 0;
+        }
+    } else {
+        low_ticks_ = 0;
+    }
+}
+
+void WorkerPool::grow() {
+    size_t index = active_.load();
+    Worker& worker = *workers_[index];
+    // Поток, остановленный при сжатии, уже в retired_ и может ещё дорабатывать очередь слота
+    worker.thread = std::thread(&WorkerPool::worker_loop, this, index, worker.generation.load());
+    active_.store(index + 1);
+    logger_->info("Запущен рабочий поток {}, всего потоков: {}", index, index + 1);
+}
+
+void WorkerPool::shrink() {
+    size_t index = active_.load() - 1;
+    active_.store(index);
+    Worker& worker = *workers_[index];
+    ++worker.generation;
+    retired_.push_back(std::move(worker.thread));
+    {
+        std::lock_guard<std::mutex> lock(worker.park_mutex);
+        worker.park_cv.notify_all();
+    }
+    logger_->info("Рабочий поток {} остановлен из-за низкой загрузки, всего потоков: {}", index, index);
+}
+
+std::vector<WorkerStats> WorkerPool::stats() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    std::vector<WorkerStats> result;
+    size_t active = active_.load();
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        const Worker& worker = *workers_[i];
+        result.push_back({i, i < active, worker.processed.load(), worker.stolen.load(), worker.utilization,
+                          worker.queue.size()});
+    }
+    return result;
+}
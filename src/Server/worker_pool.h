@@ -0,0 +1,118 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "packet_queue.h"
+#include "spdlog/spdlog.h"
+
+#define WORKER_SPIN_ITERATIONS 200
+#define WORKER_PARK_MS 50
+#define WORKER_SCALE_INTERVAL_MS 100
+#define WORKER_GROW_DEPTH 32         // средняя глубина очереди на поток, при которой пул растёт
+#define WORKER_GROW_WAIT_US 1000     // или среднее ожидание пакета в очереди
+#define WORKER_SHRINK_UTILIZATION 0.25
+#define WORKER_SHRINK_TICKS 20       // тиков подряд с низкой загрузкой перед остановкой потока
+
+struct WorkerPoolOptions {
+    size_t min_workers = 2;
+    size_t max_workers = 8;
+    uint32_t scale_interval_ms = WORKER_SCALE_INTERVAL_MS;
+    uint32_t shrink_ticks = WORKER_SHRINK_TICKS;
+};
+
+struct WorkerStats {
+    size_t id;
+    bool active;
+    uint64_t processed;
+    uint64_t stolen;
+    double utilization; // доля времени за последний интервал масштабирования, занятая обработкой
+    size_t queue_depth;
+};
+
+// Пул рабочих потоков с локальными очередями. Поток приёма раскладывает пакеты по очередям
+// активных потоков по кругу, поток без работы крадёт пакеты из чужих очередей, затем
+// недолго крутится и засыпает. Размер пула меняется между min_workers и max_workers
+// по глубине очередей, времени ожидания и загрузке.
+class WorkerPool {
+public:
+    using Handler = std::function<void(const Packet&)>;
+
+    WorkerPool(const WorkerPoolOptions& options, Handler handler, std::shared_ptr<spdlog::logger> logger);
+    ~WorkerPool();
+
+    void start();
+    // Останавливает потоки; пакеты, оставшиеся в очередях, отбрасываются
+    void stop();
+
+    // Вызывается из потока приёма и потока кластера; false — все очереди заполнены
+    bool submit(const Packet& packet);
+
+    // Новые границы при перезагрузке конфигурации; max_workers не больше числа слотов, выделенных при создании
+    void set_limits(size_t min_workers, size_t max_workers);
+
+    size_t queue_capacity() const { return queue_capacity_; }
+    size_t active_workers() const { return active_.load(); }
+    size_t min_workers() const { return min_workers_.load(); }
+    size_t max_workers() const { return max_workers_.load(); }
+    std::vector<WorkerStats> stats();
+
+private:
+    struct Worker {
+        explicit Worker(size_t capacity) : queue(capacity) {}
+
+        PacketQueue queue;
+        std::thread thread;
+        std::mutex park_mutex;
+        std::condition_variable park_cv;
+        std::atomic<uint32_t> parked{0};     // сколько потоков слота спит: старый поток может ещё дорабатывать
+        std::atomic<uint64_t> generation{0}; // меняется при остановке потока слота
+        std::atomic<uint64_t> processed{0};
+        std::atomic<uint64_t> stolen{0};
+        std::atomic<uint64_t> busy_ns{0};
+        std::atomic<uint64_t> wait_ns{0};
+        // Снимок для расчёта загрузки, меняется только под stats_mutex_
+        uint64_t last_busy_ns = 0;
+        uint64_t last_processed = 0;
+        uint64_t last_wait_ns = 0;
+        double utilization = 0;
+    };
+
+    void worker_loop(size_t index, uint64_t generation);
+    bool steal(size_t index, Packet& packet);
+    void run(Worker& worker, const Packet& packet);
+    void park(Worker& worker, uint64_t generation);
+    void wake(Worker& worker);
+    void scale_loop();
+    void scale();
+    void grow();
+    void shrink();
+    void join_retired(std::unique_lock<std::mutex>& lock);
+
+    WorkerPoolOptions options_;
+    Handler handler_;
+    std::shared_ptr<spdlog::logger> logger_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<size_t> active_{0};
+    std::atomic<size_t> min_workers_;
+    std::atomic<size_t> max_workers_;
+    std::atomic<bool> stop_{false};
+    std::atomic<size_t> next_{0};
+    size_t spin_limit_;
+    size_t queue_capacity_;
+    std::thread scale_thread_;
+    std::mutex stats_mutex_;
+    std::vector<std::thread> retired_; // остановленные потоки, которые ещё не присоединены
+    std::condition_variable scale_cv_;
+    uint64_t last_tick_ns_ = 0;
+    uint32_t low_ticks_ = 0;
+};
+
+#endif
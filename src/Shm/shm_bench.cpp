@@ -0,0 +1,104 @@
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+#include "../Utils/utils.h"
+#include "shm_producer.h"
+
+// Сравнение задержки запрос-ответ через UDP (старый формат) и через канал в разделяемой памяти.
+// Сервер должен быть запущен с тем же конфигом и заданным shm_name.
+
+using bench_clock = std::chrono::steady_clock;
+
+static void report(const char* name, std::vector<double>& latencies_us, double total_sec) {
+    if (latencies_us.empty()) {
+        std::cout << name << ": нет успешных запросов" << std::endl;
+        return;
+    }
+    std::sort(latencies_us.begin(), latencies_us.end());
+    double sum = 0;
+    for (double l : latencies_us) sum += l;
+    auto pct = [&](double p) { return latencies_us[static_cast<size_t>(p * (latencies_us.size() - 1))]; };
+    std::cout << name << ": " << latencies_us.size() << " запросов, " << latencies_us.size() / total_sec << " запр/с, "
+              << "среднее " << sum / latencies_us.size() << " мкс, p50 " << pct(0.5) << " мкс, p99 " << pct(0.99)
+              << " мкс, max " << latencies_us.back() << " мкс" << std::endl;
+}
+
+static int usage(const char* program) {
+    std::cerr << "Usage: " << program << " <server_config.json> <count> [IMSI]" << std::endl;
+    return 1;
+}
+
+// Целое в [min, max] без лишних символов
+static bool parse_long(const char* text, long min, long max, long& value) {
+    char* end = nullptr;
+    errno = 0;
+    value = std::strtol(text, &end, 10);
+    return errno == 0 && end != text && *end == '\0' && value >= min && value <= max;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3 || argc > 4) return usage(argv[0]);
+    long count = 0;
+    if (!parse_long(argv[2], 1, 100000000, count)) {
+        std::cerr << "Некорректное число запросов: " << argv[2] << std::endl;
+        return usage(argv[0]);
+    }
+    std::string imsi = argc > 3 ? argv[3] : "250990000000001";
+    if (imsi_key_from_string(imsi) == IMSI_KEY_INVALID) {
+        std::cerr << "Некорректный IMSI: " << imsi << std::endl;
+        return usage(argv[0]);
+    }
+    auto config = load_pgw_server_config(argv[1]);
+    std::vector<uint8_t> bcd = encode_bcd(imsi);
+
+    std::string ip = config.udp_ip == "0.0.0.0" ? "127.0.0.1" : config.udp_ip;
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct timeval tv = {1, 0};
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(config.udp_port);
+    if (sockfd < 0 || inet_pton(AF_INET, ip.c_str(), &server_addr.sin_addr) <= 0) {
+        std::cerr << "Ошибка создания UDP-сокета" << std::endl;
+        return 1;
+    }
+
+    std::vector<double> latencies;
+    char buffer[64];
+    auto start = bench_clock::now();
+    for (long i = 0; i < count; ++i) {
+        auto t0 = bench_clock::now();
+        sendto(sockfd, bcd.data(), bcd.size(), 0, (struct sockaddr*)&server_addr, sizeof(server_addr));
+        if (recv(sockfd, buffer, sizeof(buffer), 0) > 0) {
+            latencies.push_back(std::chrono::duration<double, std::micro>(bench_clock::now() - t0).count());
+        }
+    }
+    report("UDP", latencies, std::chrono::duration<double>(bench_clock::now() - start).count());
+    close(sockfd);
+
+    ShmProducer producer;
+    if (config.shm_name.empty() || !producer.connect(config.shm_name)) {
+        std::cerr << "Не удалось подключиться к каналу в разделяемой памяти: " << config.shm_name << std::endl;
+        return 1;
+    }
+    latencies.clear();
+    start = bench_clock::now();
+    for (long i = 0; i < count; ++i) {
+        auto t0 = bench_clock::now();
+        uint8_t status;
+        if (producer.request(bcd.data(), bcd.size(), 1000, status)) {
+            latencies.push_back(std::chrono::duration<double, std::micro>(bench_clock::now() - t0).count());
+        }
+    }
+    report("SHM", latencies, std::chrono::duration<double>(bench_clock::now() - start).count());
+    return 0;
+}
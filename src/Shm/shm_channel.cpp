@@ -0,0 +1,117 @@
+#include "shm_channel.h"
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+
+ShmChannel::~ShmChannel() {
+    destroy();
+}
+
+bool ShmChannel::create(const std::string& name, uint32_t capacity) {
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0) return false;
+    destroy();
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0660);
+    if (fd < 0) return false;
+    size_t size = shm_region_size(capacity);
+    if (ftruncate(fd, 0) < 0 || ftruncate(fd, size) < 0) {
+        close(fd);
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED) {
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    header_ = new (region) ShmHeader();
+    header_->version = SHM_VERSION;
+    header_->capacity = capacity;
+    header_->consumer_sleeping.store(0);
+    header_->doorbell.store(0);
+    header_->enqueue_pos.store(0);
+    header_->dequeue_pos.store(0);
+    header_->next_slot.store(0);
+    cells_ = shm_cells(header_);
+    slots_ = shm_slots(header_);
+    for (uint32_t i = 0; i < capacity; ++i) {
+        new (&cells_[i]) ShmCell();
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+        new (&slots_[i]) ShmSlot();
+        slots_[i].state.store(SHM_SLOT_FREE, std::memory_order_relaxed);
+    }
+    // magic публикуется последним: продюсеры не подключатся к недоинициализированному сегменту
+    std::atomic_thread_fence(std::memory_order_release);
+    header_->magic = SHM_MAGIC;
+
+    name_ = name;
+    size_ = size;
+    capacity_ = capacity;
+    mask_ = capacity - 1;
+    rejected_ = 0;
+    return true;
+}
+
+void ShmChannel::destroy() {
+    if (!header_) return;
+    munmap(header_, size_);
+    shm_unlink(name_.c_str());
+    header_ = nullptr;
+    cells_ = nullptr;
+    slots_ = nullptr;
+    capacity_ = 0;
+    mask_ = 0;
+}
+
+bool ShmChannel::empty() const {
+    uint64_t pos = header_->dequeue_pos.load(std::memory_order_relaxed);
+    const ShmCell& cell = cells_[pos & mask_];
+    return cell.sequence.load(std::memory_order_acquire) != pos + 1;
+}
+
+size_t ShmChannel::poll(uint32_t* slots, size_t max) {
+    size_t count = 0;
+    uint64_t pos = header_->dequeue_pos.load(std::memory_order_relaxed);
+    while (count < max) {
+        ShmCell& cell = cells_[pos & mask_];
+        if (cell.sequence.load(std::memory_order_acquire) != pos + 1) break;
+        uint32_t slot = cell.slot;
+        if (slot < capacity_) {
+            slots[count++] = slot;
+        } else {
+            ++rejected_;
+        }
+        cell.sequence.store(pos + capacity_, std::memory_order_release);
+        ++pos;
+    }
+    header_->dequeue_pos.store(pos, std::memory_order_relaxed);
+    return count;
+}
+
+void ShmChannel::complete(uint32_t index, uint8_t status) {
+    ShmSlot& slot = slots_[index];
+    slot.status = status;
+    uint32_t previous = slot.state.exchange(SHM_SLOT_DONE, std::memory_order_acq_rel);
+    if (previous == SHM_SLOT_WAITING) {
+        shm_futex_wake(&slot.state);
+    } else if (previous == SHM_SLOT_ABANDONED) {
+        slot.state.store(SHM_SLOT_FREE, std::memory_order_release);
+    }
+}
+
+void ShmChannel::wait_for_work(int timeout_ms) {
+    for (int i = 0; i < shm_spin_limit(); ++i) {
+        if (!empty()) return;
+        shm_cpu_relax();
+    }
+    uint32_t bell = header_->doorbell.load(std::memory_order_acquire);
+    header_->consumer_sleeping.store(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (empty()) {
+        shm_futex_wait(&header_->doorbell, bell, timeout_ms);
+    }
+    header_->consumer_sleeping.store(0, std::memory_order_relaxed);
+}
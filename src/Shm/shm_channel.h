@@ -0,0 +1,52 @@
+#ifndef SHM_CHANNEL_H
+#define SHM_CHANNEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "shm_layout.h"
+
+// Серверная (потребительская) сторона канала. Один потребитель на канал.
+class ShmChannel {
+public:
+    ShmChannel() = default;
+    ~ShmChannel();
+    ShmChannel(const ShmChannel&) = delete;
+    ShmChannel& operator=(const ShmChannel&) = delete;
+
+    // Создаёт (или пересоздаёт) сегмент; capacity — степень двойки
+    bool create(const std::string& name, uint32_t capacity);
+    void destroy();
+
+    // Забирает до max номеров слотов с отправленными запросами, не блокируясь.
+    // Ячейки с номером слота вне канала отбрасываются и учитываются в rejected()
+    size_t poll(uint32_t* slots, size_t max);
+
+    const ShmSlot& slot(uint32_t index) const { return slots_[index]; }
+
+    // Публикует статус и будит продюсера, если он уснул
+    void complete(uint32_t index, uint8_t status);
+
+    // Спин, затем сон на futex до появления запросов или истечения timeout_ms
+    void wait_for_work(int timeout_ms);
+
+    bool is_open() const { return header_ != nullptr; }
+    uint32_t capacity() const { return capacity_; }
+    uint64_t rejected() const { return rejected_; }
+    const std::string& name() const { return name_; }
+
+private:
+    bool empty() const;
+
+    std::string name_;
+    ShmHeader* header_ = nullptr;
+    ShmCell* cells_ = nullptr;
+    ShmSlot* slots_ = nullptr;
+    size_t size_ = 0;
+    // Сегмент доступен на запись любому продюсеру, поэтому ёмкость берётся только из create()
+    uint32_t capacity_ = 0;
+    uint64_t mask_ = 0;
+    uint64_t rejected_ = 0;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef SHM_LAYOUT_H
+#define SHM_LAYOUT_H
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Разделяемая память (shm_open, /dev/shm) между pgw_server и локальными продюсерами:
+//   ShmHeader | ShmCell[capacity] | ShmSlot[capacity]
+// Продюсер захватывает свободный слот, заполняет его и кладёт номер слота в MPSC-кольцо
+// (ограниченная очередь Вьюкова). Сервер забирает номера, пишет статус в слот и будит
+// продюсера через futex, только если тот уже уснул. Продюсер будит сервер, только если
+// сервер выставил consumer_sleeping.
+
+#define SHM_MAGIC 0x50475753
+#define SHM_VERSION 1
+#define SHM_DEFAULT_SLOTS 1024
+#define SHM_SPIN_ITERATIONS 2000
+#define SHM_BCD_SIZE 8
+
+enum ShmSlotState : uint32_t {
+    SHM_SLOT_FREE = 0,
+    SHM_SLOT_CLAIMED = 1,
+    SHM_SLOT_SUBMITTED = 2,
+    SHM_SLOT_WAITING = 3,   // продюсер спит на futex слота
+    SHM_SLOT_DONE = 4,
+    SHM_SLOT_ABANDONED = 5  // продюсер ушёл по тайм-ауту, сервер освободит слот
+};
+
+struct alignas(64) ShmHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    std::atomic<uint32_t> consumer_sleeping;
+    std::atomic<uint32_t> doorbell;
+    alignas(64) std::atomic<uint64_t> enqueue_pos;
+    alignas(64) std::atomic<uint64_t> dequeue_pos;
+    alignas(64) std::atomic<uint64_t> next_slot;
+};
+
+struct ShmCell {
+    std::atomic<uint64_t> sequence;
+    uint32_t slot;
+};
+
+struct alignas(64) ShmSlot {
+    std::atomic<uint32_t> state;
+    uint32_t request_id;
+    uint8_t bcd[SHM_BCD_SIZE]; // дополняется 0xFF
+    uint8_t status;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "futex requires lock-free 32-bit atomics");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared ring requires lock-free 64-bit atomics");
+
+inline size_t shm_region_size(uint32_t capacity) {
+    return sizeof(ShmHeader) + capacity * sizeof(ShmCell) + capacity * sizeof(ShmSlot);
+}
+
+inline ShmCell* shm_cells(ShmHeader* header) {
+    return reinterpret_cast<ShmCell*>(header + 1);
+}
+
+inline ShmSlot* shm_slots(ShmHeader* header) {
+    return reinterpret_cast<ShmSlot*>(shm_cells(header) + header->capacity);
+}
+
+// Межпроцессный futex (без FUTEX_PRIVATE_FLAG)
+inline int shm_futex_wait(std::atomic<uint32_t>* addr, uint32_t expected, int timeout_ms) {
+    struct timespec ts = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    return syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT, expected,
+                   timeout_ms < 0 ? nullptr : &ts, nullptr, 0);
+}
+
+inline void shm_futex_wake(std::atomic<uint32_t>* addr, int count = INT_MAX) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE, count, nullptr, nullptr, 0);
+}
+
+// На одном ядре спин только отнимает время у второй стороны
+inline int shm_spin_limit() {
+    static const int limit = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SHM_SPIN_ITERATIONS : 0;
+    return limit;
+}
+
+inline void shm_cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+#endif
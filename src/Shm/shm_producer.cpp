@@ -0,0 +1,135 @@
+#include "shm_producer.h"
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+ShmProducer::~ShmProducer() {
+    disconnect();
+}
+
+bool ShmProducer::connect(const std::string& name) {
+    disconnect();
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(ShmHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t size = st.st_size;
+    void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (region == MAP_FAILED) return false;
+
+    ShmHeader* header = static_cast<ShmHeader*>(region);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // Индексы маскируются через capacity - 1, поэтому ёмкость обязана быть степенью двойки
+    uint32_t capacity = header->capacity;
+    if (header->magic != SHM_MAGIC || header->version != SHM_VERSION ||
+        capacity == 0 || (capacity & (capacity - 1)) != 0 ||
+        size < shm_region_size(capacity)) {
+        munmap(region, size);
+        return false;
+    }
+    header_ = header;
+    cells_ = shm_cells(header_);
+    slots_ = shm_slots(header_);
+    size_ = size;
+    capacity_ = capacity;
+    return true;
+}
+
+void ShmProducer::disconnect() {
+    if (!header_) return;
+    munmap(header_, size_);
+    header_ = nullptr;
+    cells_ = nullptr;
+    slots_ = nullptr;
+    capacity_ = 0;
+}
+
+bool ShmProducer::submit(const uint8_t* bcd, size_t len, uint32_t request_id, uint32_t& slot) {
+    if (len == 0 || len > SHM_BCD_SIZE) return false;
+    uint32_t capacity = capacity_;
+    uint64_t mask = capacity - 1;
+
+    uint64_t start = header_->next_slot.fetch_add(1, std::memory_order_relaxed);
+    bool claimed = false;
+    for (uint32_t i = 0; i < capacity && !claimed; ++i) {
+        slot = (start + i) & mask;
+        uint32_t expected = SHM_SLOT_FREE;
+        claimed = slots_[slot].state.compare_exchange_strong(expected, SHM_SLOT_CLAIMED, std::memory_order_acquire);
+    }
+    if (!claimed) return false;
+
+    ShmSlot& s = slots_[slot];
+    s.request_id = request_id;
+    memset(s.bcd, 0xFF, SHM_BCD_SIZE);
+    memcpy(s.bcd, bcd, len);
+    s.state.store(SHM_SLOT_SUBMITTED, std::memory_order_release);
+
+    // Занятых слотов не больше capacity, поэтому место в кольце всегда есть
+    uint64_t pos = header_->enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        ShmCell& cell = cells_[pos & mask];
+        int64_t diff = static_cast<int64_t>(cell.sequence.load(std::memory_order_acquire)) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            if (header_->enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                cell.slot = slot;
+                cell.sequence.store(pos + 1, std::memory_order_release);
+                break;
+            }
+        } else if (diff < 0) {
+            shm_cpu_relax();
+            pos = header_->enqueue_pos.load(std::memory_order_relaxed);
+        } else {
+            pos = header_->enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (header_->consumer_sleeping.load(std::memory_order_seq_cst)) {
+        header_->doorbell.fetch_add(1, std::memory_order_release);
+        shm_futex_wake(&header_->doorbell, 1);
+    }
+    return true;
+}
+
+bool ShmProducer::wait(uint32_t slot, int timeout_ms, uint8_t& status) {
+    ShmSlot& s = slots_[slot];
+    for (int i = 0; i < shm_spin_limit(); ++i) {
+        if (s.state.load(std::memory_order_acquire) == SHM_SLOT_DONE) break;
+        shm_cpu_relax();
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    for (;;) {
+        uint32_t state = s.state.load(std::memory_order_acquire);
+        if (state == SHM_SLOT_DONE) break;
+        if (state == SHM_SLOT_SUBMITTED &&
+            !s.state.compare_exchange_strong(state, SHM_SLOT_WAITING, std::memory_order_acq_rel)) {
+            continue;
+        }
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0) {
+            uint32_t expected = SHM_SLOT_WAITING;
+            if (s.state.compare_exchange_strong(expected, SHM_SLOT_ABANDONED, std::memory_order_acq_rel)) {
+                return false;
+            }
+            continue;
+        }
+        shm_futex_wait(&s.state, SHM_SLOT_WAITING, static_cast<int>(left));
+    }
+
+    status = s.status;
+    s.state.store(SHM_SLOT_FREE, std::memory_order_release);
+    return true;
+}
+
+bool ShmProducer::request(const uint8_t* bcd, size_t len, int timeout_ms, uint8_t& status) {
+    uint32_t slot = 0;
+    if (!submit(bcd, len, 0, slot)) return false;
+    return wait(slot, timeout_ms, status);
+}
@@ -0,0 +1,39 @@
+#ifndef SHM_PRODUCER_H
+#define SHM_PRODUCER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "shm_layout.h"
+
+// Клиентская сторона канала в разделяемой памяти. Один объект можно использовать
+// из нескольких потоков; процессов-продюсеров тоже может быть несколько.
+class ShmProducer {
+public:
+    ShmProducer() = default;
+    ~ShmProducer();
+    ShmProducer(const ShmProducer&) = delete;
+    ShmProducer& operator=(const ShmProducer&) = delete;
+
+    bool connect(const std::string& name);
+    void disconnect();
+    bool is_connected() const { return header_ != nullptr; }
+
+    // Отправляет BCD-IMSI длиной до SHM_BCD_SIZE байт; false, если все слоты заняты
+    bool submit(const uint8_t* bcd, size_t len, uint32_t request_id, uint32_t& slot);
+
+    // Ждёт ответа на submit(): сначала спин, затем futex. false по тайм-ауту —
+    // слот после этого принадлежит серверу и повторно использовать его нельзя.
+    bool wait(uint32_t slot, int timeout_ms, uint8_t& status);
+
+    bool request(const uint8_t* bcd, size_t len, int timeout_ms, uint8_t& status);
+
+private:
+    ShmHeader* header_ = nullptr;
+    ShmCell* cells_ = nullptr;
+    ShmSlot* slots_ = nullptr;
+    size_t size_ = 0;
+    uint32_t capacity_ = 0;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#include "batch_protocol.h"
+#include "byte_order.h"
+#include <cstring>
+
+static void write_header(uint8_t* out, uint8_t type, uint32_t batch_id, size_t count) {
+    out[0] = BATCH_MAGIC;
+    out[1] = BATCH_VERSION;
+    out[2] = type;
+    out[3] = 0;
+    write_u32(out + 4, batch_id);
+    write_u16(out + 8, static_cast<uint16_t>(count));
+}
+
+static BatchParseResult parse_header(const uint8_t* data, size_t bytes_received, uint8_t type,
+                                     uint32_t& batch_id, size_t& count) {
+    if (bytes_received < BATCH_HEADER_SIZE) return BATCH_PARSE_TRUNCATED;
+    if (data[0] != BATCH_MAGIC) return BATCH_PARSE_BAD_MAGIC;
+    if (data[1] != BATCH_VERSION) return BATCH_PARSE_BAD_VERSION;
+    if (data[2] != type) return BATCH_PARSE_BAD_TYPE;
+    batch_id = read_u32(data + 4);
+    count = read_u16(data + 8);
+    if (count == 0 || count > BATCH_MAX_ENTRIES) return BATCH_PARSE_BAD_COUNT;
+    return BATCH_PARSE_OK;
+}
+
+BatchParseResult BatchRequestView::parse(const uint8_t* data, size_t bytes_received) {
+    uint32_t batch_id = 0;
+    size_t count = 0;
+    BatchParseResult result = parse_header(data, bytes_received, BATCH_TYPE_REQUEST, batch_id, count);
+    if (result != BATCH_PARSE_OK) return result;
+    if (bytes_received != BATCH_HEADER_SIZE + count * BATCH_ENTRY_SIZE) return BATCH_PARSE_TRUNCATED;
+    entries_ = data + BATCH_HEADER_SIZE;
+    batch_id_ = batch_id;
+    count_ = count;
+    return BATCH_PARSE_OK;
+}
+
+uint32_t BatchRequestView::request_id(size_t i) const {
+    return read_u32(entries_ + i * BATCH_ENTRY_SIZE);
+}
+
+bool is_batch_datagram(const uint8_t* data, size_t bytes_received) {
+    return bytes_received > 0 && data[0] == BATCH_MAGIC;
+}
+
+const char* batch_parse_error(BatchParseResult result) {
+    switch (result) {
+        case BATCH_PARSE_OK: return "ok";
+        case BATCH_PARSE_TRUNCATED: return "length mismatch";
+        case BATCH_PARSE_BAD_MAGIC: return "bad magic";
+        case BATCH_PARSE_BAD_VERSION: return "unsupported version";
+        case BATCH_PARSE_BAD_TYPE: return "unexpected message type";
+        case BATCH_PARSE_BAD_COUNT: return "bad entry count";
+    }
+    return "unknown";
+}
+
+const char* batch_status_name(uint8_t status) {
+    switch (status) {
+        case BATCH_STATUS_CREATED: return "created";
+        case BATCH_STATUS_REJECTED: return "rejected";
+        case BATCH_STATUS_INVALID: return "invalid";
+    }
+    return "unknown";
+}
+
+size_t encode_batch_request(uint32_t batch_id, const uint32_t* request_ids, const uint64_t* imsi_keys,
+                            size_t count, uint8_t* out, size_t out_size) {
+    size_t size = BATCH_HEADER_SIZE + count * BATCH_ENTRY_SIZE;
+    if (count == 0 || count > BATCH_MAX_ENTRIES || size > out_size) return 0;
+    write_header(out, BATCH_TYPE_REQUEST, batch_id, count);
+    uint8_t* entry = out + BATCH_HEADER_SIZE;
+    for (size_t i = 0; i < count; ++i, entry += BATCH_ENTRY_SIZE) {
+        write_u32(entry, request_ids[i]);
+        for (size_t b = 0; b < 8; ++b) {
+            entry[4 + b] = static_cast<uint8_t>(imsi_keys[i] >> (b * 8));
+        }
+    }
+    return size;
+}
+
+size_t encode_batch_response(uint32_t batch_id, const uint8_t* statuses, size_t count,
+                             uint8_t* out, size_t out_size) {
+    size_t size = BATCH_HEADER_SIZE + count;
+    if (count == 0 || count > BATCH_MAX_ENTRIES || size > out_size) return 0;
+    write_header(out, BATCH_TYPE_RESPONSE, batch_id, count);
+    memcpy(out + BATCH_HEADER_SIZE, statuses, count);
+    return size;
+}
+
+BatchParseResult parse_batch_response(const uint8_t* data, size_t bytes_received, uint32_t& batch_id,
+                                      const uint8_t*& statuses, size_t& count) {
+    BatchParseResult result = parse_header(data, bytes_received, BATCH_TYPE_RESPONSE, batch_id, count);
+    if (result != BATCH_PARSE_OK) return result;
+    if (bytes_received != BATCH_HEADER_SIZE + count) return BATCH_PARSE_TRUNCATED;
+    statuses = data + BATCH_HEADER_SIZE;
+    return BATCH_PARSE_OK;
+}
@@ -0,0 +1,72 @@
+#ifndef BATCH_PROTOCOL_H
+#define BATCH_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Пакетный бинарный формат (все поля в сетевом порядке байт):
+//   заголовок: magic(1) version(1) type(1) flags(1) batch_id(4) count(2)
+//   запрос:    count записей вида request_id(4) bcd_imsi(8, дополнен 0xFF)
+//   ответ:     count кодов статуса по одному байту в порядке записей запроса
+// Первый байт 0xBA не может начинать корректный BCD-IMSI, поэтому формат
+// отличается от старого «один IMSI на датаграмму» по первому байту.
+
+#define BATCH_MAGIC 0xBA
+#define BATCH_VERSION 1
+#define BATCH_TYPE_REQUEST 1
+#define BATCH_TYPE_RESPONSE 2
+#define BATCH_HEADER_SIZE 10
+#define BATCH_ENTRY_SIZE 12
+#define BATCH_MAX_ENTRIES 256
+#define BATCH_MAX_REQUEST_SIZE (BATCH_HEADER_SIZE + BATCH_MAX_ENTRIES * BATCH_ENTRY_SIZE)
+#define BATCH_MAX_RESPONSE_SIZE (BATCH_HEADER_SIZE + BATCH_MAX_ENTRIES)
+
+enum BatchStatus : uint8_t {
+    BATCH_STATUS_CREATED = 0,
+    BATCH_STATUS_REJECTED = 1,
+    BATCH_STATUS_INVALID = 2
+};
+
+enum BatchParseResult {
+    BATCH_PARSE_OK,
+    BATCH_PARSE_TRUNCATED,
+    BATCH_PARSE_BAD_MAGIC,
+    BATCH_PARSE_BAD_VERSION,
+    BATCH_PARSE_BAD_TYPE,
+    BATCH_PARSE_BAD_COUNT
+};
+
+// Представление пакетного запроса поверх буфера приёма, без копирования
+class BatchRequestView {
+public:
+    BatchParseResult parse(const uint8_t* data, size_t bytes_received);
+
+    uint32_t batch_id() const { return batch_id_; }
+    size_t count() const { return count_; }
+    uint32_t request_id(size_t i) const;
+    const uint8_t* bcd(size_t i) const { return entries_ + i * BATCH_ENTRY_SIZE + 4; }
+
+private:
+    const uint8_t* entries_ = nullptr;
+    uint32_t batch_id_ = 0;
+    size_t count_ = 0;
+};
+
+bool is_batch_datagram(const uint8_t* data, size_t bytes_received);
+
+const char* batch_parse_error(BatchParseResult result);
+
+const char* batch_status_name(uint8_t status);
+
+// Возвращают длину закодированного сообщения или 0, если не хватает места
+size_t encode_batch_request(uint32_t batch_id, const uint32_t* request_ids, const uint64_t* imsi_keys,
+                            size_t count, uint8_t* out, size_t out_size);
+
+size_t encode_batch_response(uint32_t batch_id, const uint8_t* statuses, size_t count,
+                             uint8_t* out, size_t out_size);
+
+// statuses указывает внутрь data
+BatchParseResult parse_batch_response(const uint8_t* data, size_t bytes_received, uint32_t& batch_id,
+                                      const uint8_t*& statuses, size_t& count);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef BYTE_ORDER_H
+#define BYTE_ORDER_H
+
+#include <cstdint>
+
+// Чтение и запись целых в сетевом порядке байт по невыровненным адресам
+
+inline uint16_t read_u16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint32_t read_u32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+}
+
+inline uint64_t read_u64(const uint8_t* p) {
+    return (static_cast<uint64_t>(read_u32(p)) << 32) | read_u32(p + 4);
+}
+
+inline void write_u16(uint8_t* p, uint16_t value) {
+    p[0] = value >> 8;
+    p[1] = value;
+}
+
+inline void write_u32(uint8_t* p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+inline void write_u64(uint8_t* p, uint64_t value) {
+    write_u32(p, static_cast<uint32_t>(value >> 32));
+    write_u32(p + 4, static_cast<uint32_t>(value));
+}
+
+#endif
@@ -3,6 +3,7 @@
 #include <nlohmann/json.hpp>
 #include <regex>
 #include <cctype>
+#include <cstring>
 #include "spdlog/spdlog.h"
 
 using json = nlohmann::json;
@@ -40,6 +41,43 @@ bool validate_pgw_client_config(const pgw_client_config& config) {
         std::cerr << "Invalid log level: " << config.log_level << std::endl;
         return false;
     }
+    if (config.max_retries > 10) {
+        std::cerr << "Invalid max retries: " << config.max_retries << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static bool validate_cluster_config(const pgw_server_config& config) {
+    if (config.cluster_nodes.empty() || config.cluster_nodes.size() > 255) {
+        std::cerr << "Invalid cluster node count: " << config.cluster_nodes.size() << std::endl;
+        return false;
+    }
+    bool self_found = false;
+    for (size_t i = 0; i < config.cluster_nodes.size(); ++i) {
+        const auto& node = config.cluster_nodes[i];
+        if (node.id.empty() || !is_valid_ip(node.ip) || node.port == 0 || node.port > 65535) {
+            std::cerr << "Invalid cluster node: " << node.id << " " << node.ip << ":" << node.port << std::endl;
+            return false;
+        }
+        for (size_t k = 0; k < i; ++k) {
+            if (config.cluster_nodes[k].id == node.id) {
+                std::cerr << "Duplicate cluster node id: " << node.id << std::endl;
+                return false;
+            }
+        }
+        self_found = self_found || node.id == config.cluster_node_id;
+    }
+    if (!self_found) {
+        std::cerr << "Cluster node id not listed in nodes: " << config.cluster_node_id << std::endl;
+        return false;
+    }
+    if (config.cluster_virtual_nodes == 0 || config.cluster_heartbeat_ms == 0 ||
+        config.cluster_failure_timeout_ms <= config.cluster_heartbeat_ms) {
+        std::cerr << "Invalid cluster timing: heartbeat " << config.cluster_heartbeat_ms
+                  << " ms, failure timeout " << config.cluster_failure_timeout_ms << " ms" << std::endl;
+        return false;
+    }
     return true;
 }
 
@@ -74,6 +112,18 @@ bool validate_pgw_server_config(const pgw_server_config& config) {
         std::cerr << "Invalid log level: " << config.log_level << std::endl;
         return false;
     }
+    if (config.cdr_rotate_bytes != 0 && config.cdr_rotate_bytes < 4096) {
+        std::cerr << "Invalid CDR rotation size: " << config.cdr_rotate_bytes << std::endl;
+        return false;
+    }
+    if (config.cdr_index_capacity < 1024 || config.cdr_index_capacity > 16 * 1024 * 1024) {
+        std::cerr << "Invalid CDR index capacity: " << config.cdr_index_capacity << std::endl;
+        return false;
+    }
+    if (config.workers_min == 0 || config.workers_max < config.workers_min || config.workers_max > 256) {
+        std::cerr << "Invalid worker pool size: " << config.workers_min << ".." << config.workers_max << std::endl;
+        return false;
+    }
     if (config.session_timeout_sec == 0) {
         std::cerr << "Invalid session timeout: " << config.session_timeout_sec << std::endl;
         return false;
@@ -82,6 +132,18 @@ bool validate_pgw_server_config(const pgw_server_config& config) {
         std::cerr << "Invalid graceful shutdown rate: " << config.graceful_shutdown_rate << std::endl;
         return false;
     }
+    if (!config.shm_name.empty() && (config.shm_name[0] != '/' || config.shm_name.find('/', 1) != std::string::npos)) {
+        std::cerr << "Invalid shared memory name: " << config.shm_name << std::endl;
+        return false;
+    }
+    if (!config.shm_name.empty() && (config.shm_slots < 2 || config.shm_slots > 65536 ||
+                                     (config.shm_slots & (config.shm_slots - 1)) != 0)) {
+        std::cerr << "Invalid shared memory slot count: " << config.shm_slots << std::endl;
+        return false;
+    }
+    if (!config.cluster_node_id.empty() && !validate_cluster_config(config)) {
+        return false;
+    }
     return true;
 }
 
@@ -125,6 +187,60 @@ std::string decode_bcd(const std::vector<uint8_t>& bcd) {
     return imsi;
 }
 
+uint64_t imsi_key_from_bcd(const uint8_t* bcd, size_t len) {
+    if (len == 0 || len > IMSI_BCD_MAX_BYTES) return IMSI_KEY_INVALID;
+    uint64_t key = IMSI_KEY_INVALID;
+    bool filler = false;
+    size_t digits = 0;
+    for (size_t i = 0; i < len; ++i) {
+        uint8_t nibbles[2] = {static_cast<uint8_t>(bcd[i] & 0x0F), static_cast<uint8_t>((bcd[i] >> 4) & 0x0F)};
+        for (uint8_t nibble : nibbles) {
+            if (nibble == 0x0F) {
+                filler = true;
+            } else if (nibble > 9 || filler) {
+                return IMSI_KEY_INVALID;
+            } else {
+                ++digits;
+            }
+        }
+        key &= ~(static_cast<uint64_t>(0xFF) << (i * 8));
+        key |= static_cast<uint64_t>(bcd[i]) << (i * 8);
+    }
+    if (digits == 0 || digits > IMSI_MAX_DIGITS) return IMSI_KEY_INVALID;
+    return key;
+}
+
+uint64_t imsi_key_from_string(const std::string& imsi) {
+    return imsi_key_from_digits(imsi.data(), imsi.length());
+}
+
+uint64_t imsi_key_from_digits(const char* imsi, size_t len) {
+    if (len == 0 || len > IMSI_MAX_DIGITS) return IMSI_KEY_INVALID;
+    uint8_t bcd[IMSI_BCD_MAX_BYTES];
+    memset(bcd, 0xFF, sizeof(bcd));
+    for (size_t i = 0; i < len; ++i) {
+        if (!std::isdigit(static_cast<unsigned char>(imsi[i]))) return IMSI_KEY_INVALID;
+        uint8_t digit = imsi[i] - '0';
+        if (i % 2 == 0) {
+            bcd[i / 2] = 0xF0 | digit;
+        } else {
+            bcd[i / 2] = (bcd[i / 2] & 0x0F) | (digit << 4);
+        }
+    }
+    return imsi_key_from_bcd(bcd, (len + 1) / 2);
+}
+
+size_t imsi_key_to_digits(uint64_t key, char* out) {
+    size_t len = 0;
+    for (size_t i = 0; i < IMSI_BCD_MAX_BYTES * 2 && len < IMSI_MAX_DIGITS; ++i) {
+        uint8_t nibble = (key >> (i * 4)) & 0x0F;
+        if (nibble == 0x0F) break;
+        out[len++] = '0' + nibble;
+    }
+    out[len] = '\0';
+    return len;
+}
+
 pgw_server_config load_pgw_server_config(const std::string& config_path) {
     pgw_server_config config;
     std::ifstream file(config_path);
@@ -144,11 +260,31 @@ pgw_server_config load_pgw_server_config(const std::string& config_path) {
         config.udp_port = j["udp_port"].get<int>();
         config.session_timeout_sec = j["session_timeout_sec"].get<int>();
         config.cdr_file = j["cdr_file"].get<std::string>();
+        config.cdr_rotate_bytes = j.value("cdr_rotate_bytes", 64ULL * 1024 * 1024);
+        config.cdr_index_capacity = j.value("cdr_index_capacity", 256 * 1024);
         config.http_port = j["http_port"].get<int>();
         config.graceful_shutdown_rate = j["graceful_shutdown_rate"].get<int>();
         config.log_file = j["log_file"].get<std::string>();
         config.log_level = j["log_level"].get<std::string>();
         config.blacklist = j["blacklist"].get<std::vector<std::string>>();
+        config.shm_name = j.value("shm_name", std::string());
+        config.shm_slots = j.value("shm_slots", 1024);
+        config.trace_sample_rate = j.value("trace_sample_rate", 0);
+        config.capture_file = j.value("capture_file", std::string());
+        config.workers_min = j.value("workers_min", 2);
+        config.workers_max = j.value("workers_max", 8);
+        if (j.contains("cluster")) {
+            // Только at(): const operator[] на отсутствующем ключе — assert, а конфиг перечитывается на живом сервере
+            const json& cluster = j.at("cluster");
+            config.cluster_node_id = cluster.at("node_id").get<std::string>();
+            config.cluster_virtual_nodes = cluster.value("virtual_nodes", 64);
+            config.cluster_heartbeat_ms = cluster.value("heartbeat_ms", 500);
+            config.cluster_failure_timeout_ms = cluster.value("failure_timeout_ms", 2000);
+            for (const json& node : cluster.at("nodes")) {
+                config.cluster_nodes.push_back({node.at("id").get<std::string>(), node.at("ip").get<std::string>(),
+                                                node.at("port").get<uint32_t>()});
+            }
+        }
     } catch (const json::exception& e) {
         auto logger = spdlog::get("server_logger");
         if (logger) {
@@ -180,6 +316,7 @@ pgw_client_config load_pgw_client_config(const std::string& config_path) {
         config.server_port = j["server_port"].get<int>();
         config.log_file = j["log_file"].get<std::string>();
         config.log_level = j["log_level"].get<std::string>();
+        config.max_retries = j.value("max_retries", 3u);
     } catch (const json::exception& e) {
         auto logger = spdlog::get("client_logger");
         if (logger) {
@@ -2,11 +2,25 @@
 #include "../Configs/pgw_server_config.h"
 #include <vector>
 #include <string>
+#include <cstddef>
+
+#define IMSI_MAX_DIGITS 15
+#define IMSI_BCD_MAX_BYTES 8
+#define IMSI_KEY_INVALID UINT64_MAX
 
 std::vector<uint8_t> encode_bcd(const std::string& imsi);
 
 std::string decode_bcd(const std::vector<uint8_t>& bcd);
 
+// Упаковка BCD-IMSI в 64-битный ключ без выделения памяти; IMSI_KEY_INVALID для некорректного IMSI
+uint64_t imsi_key_from_bcd(const uint8_t* bcd, size_t len);
+
+uint64_t imsi_key_from_string(const std::string& imsi);
+uint64_t imsi_key_from_digits(const char* imsi, size_t len);
+
+// Пишет цифры IMSI в out (минимум IMSI_MAX_DIGITS + 1 байт), возвращает количество цифр
+size_t imsi_key_to_digits(uint64_t key, char* out);
+
 pgw_server_config load_pgw_server_config(const std::string& config_path);
 
 pgw_client_config load_pgw_client_config(const std::string& config_path);
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+#include "capture_file.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#define TEST_CAPTURE "./test_capture.bin"
+
+class CaptureTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        memset(&source, 0, sizeof(source));
+        source.sin_family = AF_INET;
+        source.sin_port = htons(40000);
+        inet_pton(AF_INET, "10.1.2.3", &source.sin_addr);
+    }
+    void TearDown() override { std::remove(TEST_CAPTURE); }
+
+    struct sockaddr_in source;
+};
+
+TEST_F(CaptureTest, RoundTrip) {
+    CaptureWriter writer;
+    ASSERT_TRUE(writer.open(TEST_CAPTURE));
+    for (uint64_t i = 0; i < 1000; ++i) {
+        std::string payload = "datagram-" + std::to_string(i);
+        ASSERT_TRUE(writer.append(1000 + i, source, payload.data(), payload.size()));
+    }
+    writer.close();
+    EXPECT_EQ(writer.written(), 1000u);
+    EXPECT_EQ(writer.dropped(), 0u);
+
+    CaptureReader reader;
+    ASSERT_TRUE(reader.open(TEST_CAPTURE));
+    CaptureRecord record;
+    for (uint64_t i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(reader.next(record));
+        EXPECT_EQ(record.timestamp_ns, 1000 + i);
+        EXPECT_EQ(record.source.sin_port, source.sin_port);
+        EXPECT_EQ(record.source.sin_addr.s_addr, source.sin_addr.s_addr);
+        EXPECT_EQ(std::string(reinterpret_cast<const char*>(record.data), record.length),
+                  "datagram-" + std::to_string(i));
+    }
+    EXPECT_FALSE(reader.next(record));
+}
+
+TEST_F(CaptureTest, FullBufferDropsRecords) {
+    CaptureWriter writer;
+    ASSERT_TRUE(writer.open(TEST_CAPTURE, 64));
+    uint8_t payload[40] = {};
+    EXPECT_TRUE(writer.append(1, source, payload, sizeof(payload)));
+    EXPECT_FALSE(writer.append(2, source, payload, sizeof(payload)));
+    writer.close();
+    EXPECT_EQ(writer.written(), 1u);
+    EXPECT_EQ(writer.dropped(), 1u);
+}
+
+TEST_F(CaptureTest, TruncatedRecordStopsReader) {
+    {
+        CaptureWriter writer;
+        ASSERT_TRUE(writer.open(TEST_CAPTURE));
+        uint8_t payload[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+        writer.append(1, source, payload, sizeof(payload));
+        writer.append(2, source, payload, sizeof(payload));
+    }
+    std::ifstream in(TEST_CAPTURE, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::ofstream out(TEST_CAPTURE, std::ios::binary | std::ios::trunc);
+    out.write(content.data(), content.size() - 3);
+    out.close();
+
+    CaptureReader reader;
+    ASSERT_TRUE(reader.open(TEST_CAPTURE));
+    CaptureRecord record;
+    EXPECT_TRUE(reader.next(record));
+    EXPECT_FALSE(reader.next(record));
+}
+
+TEST_F(CaptureTest, RejectsForeignFile) {
+    {
+        std::ofstream out(TEST_CAPTURE, std::ios::binary);
+        out << "not a capture file";
+    }
+    CaptureReader reader;
+    EXPECT_FALSE(reader.open(TEST_CAPTURE));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
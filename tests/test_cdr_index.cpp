@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+#include "cdr_sink.h"
+#include "cdr_index.h"
+#include "utils.h"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define TEST_CDR "./test_cdr_index.log"
+
+class CdrIndexTest : public ::testing::Test {
+protected:
+    void SetUp() override { cleanup(); }
+    void TearDown() override { cleanup(); }
+
+    void cleanup() {
+        std::remove(TEST_CDR);
+        for (int i = 1; i < 64; ++i) {
+            std::string rotated = std::string(TEST_CDR) + "." + std::to_string(i);
+            std::remove(rotated.c_str());
+            std::remove((rotated + ".idx").c_str());
+        }
+    }
+
+    static void write(FileCdrSink& sink, time_t timestamp, const std::string& imsi, const char* event) {
+        ASSERT_TRUE(sink.write(timestamp, imsi.data(), imsi.size(), event, false));
+    }
+};
+
+TEST_F(CdrIndexTest, RecordFormatRoundTrip) {
+    char text[CDR_TIME_SIZE + 1];
+    format_cdr_time(1700000000, text);
+    EXPECT_STREQ(text, "2023-11-14T22:13:20Z");
+
+    std::string line = std::string(text) + ", 123456789012345, created";
+    int64_t timestamp;
+    uint64_t key;
+    ASSERT_TRUE(parse_cdr_record(line.data(), line.size(), timestamp, key));
+    EXPECT_EQ(timestamp, 1700000000);
+    EXPECT_EQ(key, imsi_key_from_string("123456789012345"));
+
+    std::string legacy = "123456789012345, timeout";
+    ASSERT_TRUE(parse_cdr_record(legacy.data(), legacy.size(), timestamp, key));
+    EXPECT_EQ(timestamp, 0);
+    EXPECT_EQ(key, imsi_key_from_string("123456789012345"));
+}
+
+TEST_F(CdrIndexTest, LookupAcrossRotatedFiles) {
+    FileCdrSink sink;
+    ASSERT_TRUE(sink.open(TEST_CDR, 4096));
+    for (int i = 0; i < 600; ++i) {
+        write(sink, 1000 + i, "00101000000000" + std::to_string(i % 10), i % 2 ? "created" : "timeout");
+    }
+    sink.flush();
+    ASSERT_GE(sink.rotated_count(), 2u);
+    sink.wait_sealed();
+    std::ifstream idx(std::string(TEST_CDR) + ".1.idx");
+    EXPECT_TRUE(idx.is_open());
+
+    CdrQuery query;
+    query.imsi_key = imsi_key_from_string("001010000000003");
+    std::vector<std::string> records;
+    EXPECT_EQ(sink.query(query, records), 60u);
+    ASSERT_EQ(records.size(), 60u);
+    EXPECT_EQ(records.front(), "1970-01-01T00:16:43Z, 001010000000003, created");
+    for (const auto& record : records) {
+        EXPECT_NE(record.find("001010000000003"), std::string::npos);
+    }
+
+    records.clear();
+    query.from = 1100;
+    query.to = 1199;
+    EXPECT_EQ(sink.query(query, records), 10u);
+
+    records.clear();
+    query.limit = 3;
+    EXPECT_EQ(sink.query(query, records), 3u);
+}
+
+TEST_F(CdrIndexTest, TimeRangeWithoutImsi) {
+    FileCdrSink sink;
+    ASSERT_TRUE(sink.open(TEST_CDR, 8192));
+    for (int i = 0; i < 2000; ++i) {
+        write(sink, 5000 + i / 4, "25099000000" + std::to_string(1000 + i), "created");
+    }
+
+    CdrQuery query;
+    query.from = 5100;
+    query.to = 5101;
+    std::vector<std::string> records;
+    EXPECT_EQ(sink.query(query, records), 8u);
+    EXPECT_EQ(records.front().find("1970-01-01T01:25:00Z"), 0u);
+    EXPECT_EQ(records.back().find("1970-01-01T01:25:01Z"), 0u);
+
+    records.clear();
+    query.from = 9000;
+    query.to = 9999;
+    EXPECT_EQ(sink.query(query, records), 0u);
+}
+
+TEST_F(CdrIndexTest, ReopenRebuildsIndexes) {
+    {
+        FileCdrSink sink;
+        ASSERT_TRUE(sink.open(TEST_CDR, 4096));
+        for (int i = 0; i < 300; ++i) write(sink, 2000 + i, "250990000000001", "created");
+        sink.flush();
+    }
+    // Потерянный индекс ротированного файла восстанавливается при запросе
+    std::remove((std::string(TEST_CDR) + ".1.idx").c_str());
+
+    FileCdrSink sink;
+    ASSERT_TRUE(sink.open(TEST_CDR, 4096));
+    write(sink, 3000, "250990000000001", "timeout");
+
+    CdrQuery query;
+    query.imsi_key = imsi_key_from_string("250990000000001");
+    std::vector<std::string> records;
+    EXPECT_EQ(sink.query(query, records), 301u);
+    EXPECT_EQ(records.back(), "1970-01-01T00:50:00Z, 250990000000001, timeout");
+}
+
+TEST_F(CdrIndexTest, FullIndexRotatesEarly) {
+    FileCdrSink sink;
+    ASSERT_TRUE(sink.open(TEST_CDR, 1024 * 1024, 100));
+    for (int i = 0; i < 250; ++i) write(sink, 4000 + i, "25099000000000" + std::to_string(i % 5), "created");
+    sink.flush();
+    EXPECT_EQ(sink.rotated_count(), 2u);
+
+    CdrQuery query;
+    query.imsi_key = imsi_key_from_string("250990000000002");
+    std::vector<std::string> records;
+    EXPECT_EQ(sink.query(query, records), 50u);
+}
+
+TEST_F(CdrIndexTest, CappedIndexWithoutRotationScansTail) {
+    {
+        FileCdrSink sink;
+        ASSERT_TRUE(sink.open(TEST_CDR, 0, 100));
+        for (int i = 0; i < 150; ++i) write(sink, 6000 + i, "25099000000000" + std::to_string(i % 3), "created");
+        sink.flush();
+        EXPECT_EQ(sink.rotated_count(), 0u);
+
+        CdrQuery query;
+        query.imsi_key = imsi_key_from_string("250990000000001");
+        std::vector<std::string> records;
+        EXPECT_EQ(sink.query(query, records), 50u);
+        EXPECT_EQ(records.back(), "1970-01-01T01:42:28Z, 250990000000001, created");
+
+        records.clear();
+        query = CdrQuery();
+        query.from = 6140;
+        EXPECT_EQ(sink.query(query, records), 10u);
+    }
+    // При повторном открытии индекс тоже строится не больше чем на capacity записей
+    FileCdrSink sink;
+    ASSERT_TRUE(sink.open(TEST_CDR, 0, 100));
+    CdrQuery query;
+    query.imsi_key = imsi_key_from_string("250990000000002");
+    std::vector<std::string> records;
+    EXPECT_EQ(sink.query(query, records), 50u);
+}
+
+TEST_F(CdrIndexTest, BackgroundSealKeepsUpWithRotations) {
+    FileCdrSink sink;
+    ASSERT_TRUE(sink.open(TEST_CDR, 4096, 1024));
+    size_t expected = 0;
+    for (int i = 0; i < 2000; ++i) {
+        write(sink, 5000 + i, "25099000000000" + std::to_string(i % 7), "created");
+        if (i % 7 == 3) ++expected;
+    }
+    sink.flush();
+    uint32_t rotated = sink.rotated_count();
+    ASSERT_GE(rotated, 10u);
+
+    // Запрос сразу после ротаций видит все записи: незаписанные индексы он дожидается, а не строит
+    CdrQuery query;
+    query.imsi_key = imsi_key_from_string("250990000000003");
+    std::vector<std::string> records;
+    EXPECT_EQ(sink.query(query, records), expected);
+    for (uint32_t i = 1; i <= rotated; ++i) {
+        CdrIndexFile index;
+        EXPECT_TRUE(index.open(std::string(TEST_CDR) + "." + std::to_string(i) + ".idx")) << i;
+    }
+}
+
+TEST_F(CdrIndexTest, CorruptIndexIsRejected) {
+    {
+        std::ofstream file(std::string(TEST_CDR) + ".1.idx", std::ios::binary);
+        file << "not an index";
+    }
+    CdrIndexFile index;
+    EXPECT_FALSE(index.open(std::string(TEST_CDR) + ".1.idx"));
+    EXPECT_FALSE(index.overlaps(0, INT64_MAX));
+}
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include "pgw_client_lib.h"
+#include "batch_protocol.h"
+#include "utils.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#define BLACKLISTED_IMSI "001010123456789"
+
+// Сервер пакетного протокола в тестовом процессе: отвечает created/rejected, умеет терять датаграммы
+class FakeServer {
+public:
+    FakeServer() {
+        sockfd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = 0;
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        bind(sockfd_, (struct sockaddr*)&addr, sizeof(addr));
+        socklen_t len = sizeof(addr);
+        getsockname(sockfd_, (struct sockaddr*)&addr, &len);
+        port_ = ntohs(addr.sin_port);
+        struct timeval tv = {0, 20000};
+        setsockopt(sockfd_, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        thread_ = std::thread(&FakeServer::run, this);
+    }
+
+    ~FakeServer() {
+        stop_ = true;
+        thread_.join();
+        close(sockfd_);
+    }
+
+    uint16_t port() const { return port_; }
+
+    std::atomic<int> drop_datagrams{0}; // сколько следующих датаграмм потерять, -1 — все
+    std::atomic<int> datagrams{0};
+    std::atomic<int> entries{0};
+
+private:
+    void run() {
+        uint8_t buffer[BATCH_MAX_REQUEST_SIZE];
+        uint8_t response[BATCH_MAX_RESPONSE_SIZE];
+        uint8_t statuses[BATCH_MAX_ENTRIES];
+        uint64_t blacklisted = imsi_key_from_string(BLACKLISTED_IMSI);
+        while (!stop_) {
+            struct sockaddr_in client;
+            socklen_t len = sizeof(client);
+            ssize_t n = recvfrom(sockfd_, buffer, sizeof(buffer), 0, (struct sockaddr*)&client, &len);
+            if (n <= 0) continue;
+            ++datagrams;
+            int drop = drop_datagrams;
+            if (drop < 0) continue;
+            if (drop > 0) {
+                --drop_datagrams;
+                continue;
+            }
+            BatchRequestView view;
+            if (view.parse(buffer, n) != BATCH_PARSE_OK) continue;
+            entries += view.count();
+            for (size_t i = 0; i < view.count(); ++i) {
+                uint64_t key = imsi_key_from_bcd(view.bcd(i), IMSI_BCD_MAX_BYTES);
+                statuses[i] = key == blacklisted ? BATCH_STATUS_REJECTED : BATCH_STATUS_CREATED;
+            }
+            size_t out = encode_batch_response(view.batch_id(), statuses, view.count(), response, sizeof(response));
+            sendto(sockfd_, response, out, 0, (struct sockaddr*)&client, len);
+        }
+    }
+
+    int sockfd_;
+    uint16_t port_;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+class ClientLibTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        options.server_port = server.port();
+        options.timeout = std::chrono::milliseconds(200);
+        options.max_retries = 2;
+        options.retry_backoff = std::chrono::milliseconds(10);
+        ASSERT_TRUE(client.connect(options));
+    }
+
+    FakeServer server;
+    PgwClientOptions options;
+    PgwClient client;
+};
+
+TEST_F(ClientLibTest, ManyRequestsInFlight) {
+    std::vector<std::future<PgwResult>> results;
+    for (int i = 0; i < 2000; ++i) {
+        results.push_back(client.request(i % 100 == 0 ? std::string(BLACKLISTED_IMSI)
+                                                      : "25099" + std::to_string(1000000000 + i)));
+    }
+    for (int i = 0; i < 2000; ++i) {
+        ASSERT_EQ(results[i].get(), i % 100 == 0 ? PGW_RESULT_REJECTED : PGW_RESULT_CREATED) << i;
+    }
+    EXPECT_EQ(server.entries.load(), 2000);
+    // Запросы, накопившиеся к моменту отправки, уходят пачками
+    EXPECT_LT(server.datagrams.load(), 2000);
+    EXPECT_EQ(client.in_flight(), 0u);
+}
+
+TEST_F(ClientLibTest, RetriesLostDatagram) {
+    server.drop_datagrams = 1;
+    EXPECT_EQ(client.request("250990000000001").get(), PGW_RESULT_CREATED);
+    EXPECT_EQ(client.retries(), 1u);
+    EXPECT_EQ(server.datagrams.load(), 2);
+}
+
+TEST_F(ClientLibTest, TimesOutAfterRetries) {
+    server.drop_datagrams = -1;
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(client.request("250990000000001", std::chrono::milliseconds(50)).get(), PGW_RESULT_TIMEOUT);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    // Три попытки по 50 мс и паузы 10 и 20 мс
+    EXPECT_GE(elapsed, std::chrono::milliseconds(180));
+    EXPECT_LT(elapsed, std::chrono::milliseconds(1000));
+    EXPECT_EQ(server.datagrams.load(), 3);
+}
+
+TEST_F(ClientLibTest, CallbackApiAndInvalidImsi) {
+    std::promise<PgwResult> done;
+    client.request(imsi_key_from_string(BLACKLISTED_IMSI), [&](PgwResult result) { done.set_value(result); });
+    EXPECT_EQ(done.get_future().get(), PGW_RESULT_REJECTED);
+    EXPECT_EQ(client.request("12ab").get(), PGW_RESULT_INVALID);
+}
+
+TEST_F(ClientLibTest, CloseFailsPendingRequests) {
+    server.drop_datagrams = -1;
+    auto pending = client.request("250990000000001", std::chrono::milliseconds(10000));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    client.close();
+    EXPECT_EQ(pending.get(), PGW_RESULT_ERROR);
+    EXPECT_EQ(client.request("250990000000001").get(), PGW_RESULT_ERROR);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
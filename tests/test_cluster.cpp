@@ -0,0 +1,395 @@
+#include <gtest/gtest.h>
+#include "cluster_node.h"
+#include "cluster_protocol.h"
+#include "hash_ring.h"
+#include "utils.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static std::string test_imsi(int i) {
+    std::string digits = std::to_string(i);
+    return "25099" + std::string(10 - digits.size(), '0') + digits;
+}
+
+static bool wait_until(const std::function<bool()>& predicate, int timeout_ms = 3000) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (predicate()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return predicate();
+}
+
+TEST(HashRingTest, SpreadsKeysAcrossNodes) {
+    HashRing ring;
+    ring.build({"a", "b", "c"}, {true, true, true}, 64);
+    int counts[3] = {0, 0, 0};
+    for (int i = 0; i < 3000; ++i) {
+        uint64_t key = imsi_key_from_string(test_imsi(i));
+        int owner = ring.owner(key);
+        ASSERT_GE(owner, 0);
+        ++counts[owner];
+        int backup = ring.successor(key, owner);
+        ASSERT_GE(backup, 0);
+        ASSERT_NE(backup, owner);
+    }
+    for (int count : counts) {
+        ASSERT_GT(count, 600);
+    }
+}
+
+TEST(HashRingTest, RemovingNodeMovesOnlyItsKeys) {
+    HashRing full;
+    HashRing reduced;
+    full.build({"a", "b", "c"}, {true, true, true}, 64);
+    reduced.build({"a", "b", "c"}, {true, false, true}, 64);
+    for (int i = 0; i < 3000; ++i) {
+        uint64_t key = imsi_key_from_string(test_imsi(i));
+        int before = full.owner(key);
+        int after = reduced.owner(key);
+        ASSERT_NE(after, 1);
+        if (before != 1) ASSERT_EQ(before, after);
+        else ASSERT_EQ(after, full.successor(key, 1));
+    }
+}
+
+TEST(HashRingTest, EmptyRing) {
+    HashRing ring;
+    ring.build({"a"}, {false}, 8);
+    ASSERT_EQ(ring.owner(1), -1);
+    ASSERT_EQ(ring.successor(1, 0), -1);
+}
+
+TEST(ClusterProtocolTest, RecordsRoundTrip) {
+    std::vector<SessionRecord> records = {{imsi_key_from_string("123"), 1700000000}, {imsi_key_from_string("456"), 5}};
+    uint8_t buffer[CLUSTER_MAX_MESSAGE];
+    size_t len = encode_cluster_records(CLUSTER_REPLICATE, 3, records.data(), records.size(), buffer, sizeof(buffer));
+    ClusterMessage message;
+    ASSERT_TRUE(parse_cluster_message(buffer, len, message));
+    ASSERT_EQ(message.type, CLUSTER_REPLICATE);
+    ASSERT_EQ(message.sender, 3);
+    ASSERT_EQ(message.count, 2u);
+    ASSERT_EQ(message.record(1).imsi_key, records[1].imsi_key);
+    ASSERT_EQ(message.record(0).start_time, records[0].start_time);
+    ASSERT_FALSE(parse_cluster_message(buffer, len - 1, message));
+
+    len = encode_cluster_records(CLUSTER_EXPIRE, 1, records.data(), records.size(), buffer, sizeof(buffer));
+    ASSERT_EQ(len, CLUSTER_HEADER_SIZE + 2 + 2 * 8u);
+    ASSERT_TRUE(parse_cluster_message(buffer, len, message));
+    ASSERT_EQ(message.record(1).imsi_key, records[1].imsi_key);
+}
+
+TEST(ClusterProtocolTest, HandoffAckCarriesKeysOnly) {
+    std::vector<SessionRecord> records = {{imsi_key_from_string("123"), 1700000000}};
+    uint8_t buffer[CLUSTER_MAX_MESSAGE];
+    size_t len = encode_cluster_records(CLUSTER_HANDOFF_ACK, 2, records.data(), records.size(), buffer, sizeof(buffer));
+    ASSERT_EQ(len, CLUSTER_HEADER_SIZE + 2 + 8u);
+    ClusterMessage message;
+    ASSERT_TRUE(parse_cluster_message(buffer, len, message));
+    ASSERT_EQ(message.type, CLUSTER_HANDOFF_ACK);
+    ASSERT_EQ(message.record(0).imsi_key, records[0].imsi_key);
+    ASSERT_EQ(message.record(0).start_time, 0);
+}
+
+TEST(ClusterProtocolTest, ForwardRoundTrip) {
+    struct sockaddr_in client;
+    memset(&client, 0, sizeof(client));
+    client.sin_port = htons(40000);
+    inet_pton(AF_INET, "10.1.2.3", &client.sin_addr);
+    std::vector<uint8_t> payload = encode_bcd("001010123456789");
+    uint8_t buffer[CLUSTER_MAX_MESSAGE];
+    size_t len = encode_cluster_forward(CLUSTER_FORWARD, 0, client, payload.data(), payload.size(), buffer, sizeof(buffer));
+    ClusterMessage message;
+    ASSERT_TRUE(parse_cluster_message(buffer, len, message));
+    ASSERT_EQ(message.client.sin_port, client.sin_port);
+    ASSERT_EQ(message.client.sin_addr.s_addr, client.sin_addr.s_addr);
+    ASSERT_EQ(std::vector<uint8_t>(message.payload, message.payload + message.payload_len), payload);
+}
+
+// Несколько узлов в одном процессе на loopback
+class ClusterTest : public ::testing::Test {
+protected:
+    struct Node {
+        pgw_server_config config;
+        std::unique_ptr<PgwEngine> engine;
+        std::unique_ptr<ClusterNode> cluster;
+        int client_sockfd = -1;
+    };
+
+    void SetUp() override {
+        base.session_timeout_sec = 60;
+        base.graceful_shutdown_rate = 10;
+        base.cluster_heartbeat_ms = 50;
+        base.cluster_failure_timeout_ms = 300;
+        base.cluster_virtual_nodes = 32;
+        int port = 19100 + (getpid() % 500) * 4;
+        base.cluster_nodes = {{"a", "127.0.0.1", static_cast<uint32_t>(port)},
+                              {"b", "127.0.0.1", static_cast<uint32_t>(port + 1)}};
+        nodes.resize(2);
+    }
+
+    void TearDown() override {
+        for (auto& node : nodes) stop(node);
+    }
+
+    void start(Node& node, const std::string& id, EngineClock clock = nullptr) {
+        node.config = base;
+        node.config.cluster_node_id = id;
+        node.engine = std::make_unique<PgwEngine>(node.config, nullptr, nullptr, std::move(clock));
+        node.cluster = std::make_unique<ClusterNode>(node.config, *node.engine, nullptr);
+        node.engine->set_session_listener(node.cluster.get());
+        node.client_sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+        ASSERT_TRUE(node.cluster->start(node.client_sockfd, [this, &node](const uint8_t* data, size_t len,
+                                                                           const struct sockaddr_in& client, int sender) {
+            if (defer_forwarded) {
+                std::lock_guard<std::mutex> lock(forwarded_mutex);
+                forwarded.push_back({std::vector<uint8_t>(data, data + len), client, sender, &node});
+                return true;
+            }
+            answer(node, data, len, client, sender);
+            return true;
+        }));
+    }
+
+    static void answer(Node& node, const uint8_t* data, size_t len, const struct sockaddr_in& client, int sender) {
+        bool created = node.engine->process(imsi_key_from_bcd(data, len)) == BATCH_STATUS_CREATED;
+        const char* status = created ? "created" : "rejected";
+        node.cluster->reply(sender, client, reinterpret_cast<const uint8_t*>(status), strlen(status));
+    }
+
+    void stop(Node& node) {
+        if (node.cluster) node.cluster->stop();
+        if (node.engine) node.engine->set_session_listener(nullptr);
+        node.cluster.reset();
+        node.engine.reset();
+        if (node.client_sockfd >= 0) close(node.client_sockfd);
+        node.client_sockfd = -1;
+    }
+
+    uint64_t key_owned_by(ClusterNode& cluster, int owner) {
+        for (int i = 0;; ++i) {
+            uint64_t key = imsi_key_from_string(test_imsi(i));
+            if (cluster.owner_of(key) == owner) return key;
+        }
+    }
+
+    // Пересланный запрос, отложенный тестом вместо рабочего потока
+    struct Forwarded {
+        std::vector<uint8_t> data;
+        struct sockaddr_in client;
+        int sender;
+        Node* node;
+    };
+
+    pgw_server_config base;
+    std::vector<Node> nodes;
+    std::atomic<bool> defer_forwarded{false};
+    std::mutex forwarded_mutex;
+    std::vector<Forwarded> forwarded;
+};
+
+TEST_F(ClusterTest, ForwardsToOwnerAndRelaysReply) {
+    start(nodes[0], "a");
+    start(nodes[1], "b");
+    ASSERT_TRUE(wait_until([&] { return nodes[0].cluster->is_alive(1) && nodes[1].cluster->is_alive(0); }));
+
+    int client = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in client_addr;
+    memset(&client_addr, 0, sizeof(client_addr));
+    client_addr.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &client_addr.sin_addr);
+    ASSERT_EQ(bind(client, (struct sockaddr*)&client_addr, sizeof(client_addr)), 0);
+    socklen_t len = sizeof(client_addr);
+    getsockname(client, (struct sockaddr*)&client_addr, &len);
+    struct timeval tv = {2, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    uint64_t key = key_owned_by(*nodes[0].cluster, 1);
+    uint8_t bcd[IMSI_BCD_MAX_BYTES];
+    for (int i = 0; i < IMSI_BCD_MAX_BYTES; ++i) bcd[i] = key >> (i * 8);
+    ASSERT_TRUE(nodes[0].cluster->route(bcd, sizeof(bcd), client_addr));
+
+    char reply[32] = {};
+    ASSERT_GT(recv(client, reply, sizeof(reply) - 1, 0), 0);
+    ASSERT_STREQ(reply, "created");
+    ASSERT_TRUE(nodes[1].engine->is_active(key));
+    ASSERT_FALSE(nodes[0].engine->is_active(key));
+
+    uint64_t local = key_owned_by(*nodes[0].cluster, 0);
+    for (int i = 0; i < IMSI_BCD_MAX_BYTES; ++i) bcd[i] = local >> (i * 8);
+    ASSERT_FALSE(nodes[0].cluster->route(bcd, sizeof(bcd), client_addr));
+    close(client);
+}
+
+TEST_F(ClusterTest, SlowForwardedRequestDoesNotDelayHeartbeat) {
+    defer_forwarded = true;
+    start(nodes[0], "a");
+    start(nodes[1], "b");
+    ASSERT_TRUE(wait_until([&] { return nodes[0].cluster->is_alive(1) && nodes[1].cluster->is_alive(0); }));
+
+    int client = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in client_addr;
+    memset(&client_addr, 0, sizeof(client_addr));
+    client_addr.sin_family = AF_INET;
+    inet_pton(AF_INET, "127.0.0.1", &client_addr.sin_addr);
+    ASSERT_EQ(bind(client, (struct sockaddr*)&client_addr, sizeof(client_addr)), 0);
+    socklen_t len = sizeof(client_addr);
+    getsockname(client, (struct sockaddr*)&client_addr, &len);
+    struct timeval tv = {2, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    uint64_t key = key_owned_by(*nodes[0].cluster, 1);
+    uint8_t bcd[IMSI_BCD_MAX_BYTES];
+    for (int i = 0; i < IMSI_BCD_MAX_BYTES; ++i) bcd[i] = key >> (i * 8);
+    ASSERT_TRUE(nodes[0].cluster->route(bcd, sizeof(bcd), client_addr));
+    ASSERT_TRUE(wait_until([&] {
+        std::lock_guard<std::mutex> lock(forwarded_mutex);
+        return forwarded.size() == 1;
+    }));
+
+    // Запрос «обрабатывается» дольше тайм-аута отказа, а узлы продолжают видеть друг друга
+    std::this_thread::sleep_for(std::chrono::milliseconds(base.cluster_failure_timeout_ms * 2));
+    EXPECT_TRUE(nodes[0].cluster->is_alive(1));
+    EXPECT_TRUE(nodes[1].cluster->is_alive(0));
+
+    Forwarded request;
+    {
+        std::lock_guard<std::mutex> lock(forwarded_mutex);
+        request = forwarded.front();
+    }
+    answer(*request.node, request.data.data(), request.data.size(), request.client, request.sender);
+    char reply[32] = {};
+    ASSERT_GT(recv(client, reply, sizeof(reply) - 1, 0), 0);
+    EXPECT_STREQ(reply, "created");
+    EXPECT_TRUE(nodes[1].engine->is_active(key));
+    close(client);
+}
+
+TEST_F(ClusterTest, BackupPromotesReplicasOnFailure) {
+    start(nodes[0], "a");
+    start(nodes[1], "b");
+    ASSERT_TRUE(wait_until([&] { return nodes[0].cluster->is_alive(1) && nodes[1].cluster->is_alive(0); }));
+
+    uint64_t key = key_owned_by(*nodes[0].cluster, 1);
+    nodes[1].engine->process(key);
+    ASSERT_TRUE(wait_until([&] { return nodes[0].cluster->replica_count() == 1; }));
+    ASSERT_FALSE(nodes[0].engine->is_active(key));
+
+    stop(nodes[1]);
+    ASSERT_TRUE(wait_until([&] { return nodes[0].engine->is_active(key); }));
+    ASSERT_FALSE(nodes[0].cluster->is_alive(1));
+    ASSERT_EQ(nodes[0].cluster->replica_count(), 0u);
+}
+
+TEST_F(ClusterTest, JoiningNodeReceivesItsSessions) {
+    start(nodes[0], "a");
+    const int total = 200;
+    for (int i = 0; i < total; ++i) {
+        nodes[0].engine->process(imsi_key_from_string(test_imsi(i)));
+    }
+    ASSERT_EQ(nodes[0].engine->session_count(), static_cast<size_t>(total));
+
+    start(nodes[1], "b");
+    ASSERT_TRUE(wait_until([&] {
+        return nodes[1].engine->session_count() > 0 &&
+               nodes[0].engine->session_count() + nodes[1].engine->session_count() == total;
+    }));
+    for (int i = 0; i < total; ++i) {
+        uint64_t key = imsi_key_from_string(test_imsi(i));
+        int owner = nodes[0].cluster->owner_of(key);
+        ASSERT_TRUE(nodes[owner].engine->is_active(key));
+    }
+    EXPECT_TRUE(wait_until([&] { return nodes[0].cluster->handoffs_in_flight() == 0; }));
+}
+
+TEST_F(ClusterTest, HandoffExpiresReplicaAtPreviousBackup) {
+    base.cluster_nodes.push_back({"c", "127.0.0.1", base.cluster_nodes[1].port + 1});
+    nodes.resize(3);
+    start(nodes[0], "a");
+    start(nodes[1], "b");
+    ASSERT_TRUE(wait_until([&] { return nodes[0].cluster->is_alive(1) && nodes[1].cluster->is_alive(0); }));
+
+    const int total = 200;
+    for (int i = 0; i < total; ++i) {
+        uint64_t key = imsi_key_from_string(test_imsi(i));
+        nodes[nodes[0].cluster->owner_of(key)].engine->process(key);
+    }
+    ASSERT_TRUE(wait_until([&] {
+        return nodes[0].cluster->replica_count() + nodes[1].cluster->replica_count() == total;
+    }));
+
+    // Каждая сессия после перераспределения реплицирована ровно один раз: у прежних резервных узлов
+    // не остаётся копий сессий, переданных новому владельцу
+    start(nodes[2], "c");
+    auto sessions = [&] {
+        size_t count = 0;
+        for (auto& node : nodes) count += node.engine->session_count();
+        return count;
+    };
+    auto replicas = [&] {
+        size_t count = 0;
+        for (auto& node : nodes) count += node.cluster->replica_count();
+        return count;
+    };
+    ASSERT_TRUE(wait_until([&] {
+        return nodes[2].engine->session_count() > 0 && sessions() == total && replicas() == total;
+    }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    EXPECT_EQ(sessions(), static_cast<size_t>(total));
+    EXPECT_EQ(replicas(), static_cast<size_t>(total));
+}
+
+TEST_F(ClusterTest, UnacknowledgedHandoffIsReadopted) {
+    start(nodes[0], "a");
+    const int total = 200;
+    for (int i = 0; i < total; ++i) {
+        nodes[0].engine->process(imsi_key_from_string(test_imsi(i)));
+    }
+
+    // Узел b «появляется» по одному heartbeat, но его порт никто не слушает: HANDOFF теряется
+    int fake = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in a_addr;
+    memset(&a_addr, 0, sizeof(a_addr));
+    a_addr.sin_family = AF_INET;
+    a_addr.sin_port = htons(base.cluster_nodes[0].port);
+    inet_pton(AF_INET, "127.0.0.1", &a_addr.sin_addr);
+    uint8_t heartbeat[CLUSTER_HEADER_SIZE];
+    size_t len = encode_cluster_heartbeat(1, heartbeat, sizeof(heartbeat));
+    sendto(fake, heartbeat, len, 0, (struct sockaddr*)&a_addr, sizeof(a_addr));
+    close(fake);
+
+    ASSERT_TRUE(wait_until([&] { return nodes[0].cluster->handoffs_in_flight() > 0; }));
+    EXPECT_LT(nodes[0].engine->session_count(), static_cast<size_t>(total));
+
+    // b признан недоступным, неподтверждённые сессии возвращаются к a
+    ASSERT_TRUE(wait_until([&] {
+        return nodes[0].cluster->handoffs_in_flight() == 0 &&
+               nodes[0].engine->session_count() == static_cast<size_t>(total);
+    }));
+    EXPECT_FALSE(nodes[0].cluster->is_alive(1));
+}
+
+TEST_F(ClusterTest, ReplicasExpireByEngineClock) {
+    std::atomic<time_t> b_now(time(nullptr));
+    start(nodes[0], "a");
+    start(nodes[1], "b", [&b_now] { return b_now.load(); });
+    ASSERT_TRUE(wait_until([&] { return nodes[0].cluster->is_alive(1) && nodes[1].cluster->is_alive(0); }));
+
+    nodes[0].engine->process(key_owned_by(*nodes[0].cluster, 0));
+    ASSERT_TRUE(wait_until([&] { return nodes[1].cluster->replica_count() == 1; }));
+
+    b_now = b_now.load() + base.session_timeout_sec + 1;
+    EXPECT_TRUE(wait_until([&] { return nodes[1].cluster->replica_count() == 0; }));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include "pgw_engine.h"
+#include "utils.h"
+#include <string>
+#include <vector>
+
+class MemoryCdrSink : public CdrSink {
+public:
+    bool write(time_t, const char* imsi, size_t imsi_len, const char* event, bool) override {
+        records.push_back(std::string(imsi, imsi_len) + ", " + event);
+        return true;
+    }
+    const std::string& path() const override { return path_; }
+
+    std::vector<std::string> records;
+
+private:
+    std::string path_ = "memory";
+};
+
+class EngineTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        config.session_timeout_sec = 30;
+        config.graceful_shutdown_rate = 1;
+        config.blacklist = {"001010123456789"};
+        cdr = std::make_shared<MemoryCdrSink>();
+        engine = std::make_unique<PgwEngine>(config, nullptr, cdr, [this] { return now; });
+    }
+
+    pgw_server_config config;
+    std::shared_ptr<MemoryCdrSink> cdr;
+    std::unique_ptr<PgwEngine> engine;
+    time_t now = 1000;
+};
+
+TEST_F(EngineTest, ProcessBatchStatuses) {
+    std::vector<Request> requests = {
+        {10, imsi_key_from_string("123456789012345")},
+        {11, imsi_key_from_string("001010123456789")},
+        {12, IMSI_KEY_INVALID},
+    };
+    std::vector<Response> responses(requests.size());
+    ASSERT_EQ(engine->process_batch(requests, responses), 3u);
+
+    ASSERT_EQ(responses[0].id, 10u);
+    ASSERT_EQ(responses[0].status, BATCH_STATUS_CREATED);
+    ASSERT_EQ(responses[1].status, BATCH_STATUS_REJECTED);
+    ASSERT_EQ(responses[2].status, BATCH_STATUS_INVALID);
+    ASSERT_EQ(engine->session_count(), 1u);
+    ASSERT_TRUE(engine->is_active(requests[0].imsi_key));
+    ASSERT_FALSE(engine->is_active(requests[1].imsi_key));
+
+    std::vector<std::string> expected = {"123456789012345, created", "001010123456789, rejected"};
+    ASSERT_EQ(cdr->records, expected);
+}
+
+TEST_F(EngineTest, ProcessBatchLimitedByResponses) {
+    std::vector<Request> requests = {
+        {1, imsi_key_from_string("111")},
+        {2, imsi_key_from_string("222")},
+    };
+    Response responses[1];
+    ASSERT_EQ(engine->process_batch(requests, responses), 1u);
+    ASSERT_EQ(engine->session_count(), 1u);
+}
+
+TEST_F(EngineTest, RepeatedIMSIKeepsSingleSession) {
+    uint64_t key = imsi_key_from_string("250990000000001");
+    ASSERT_EQ(engine->process(key), BATCH_STATUS_CREATED);
+    ASSERT_EQ(engine->process(key), BATCH_STATUS_CREATED);
+    ASSERT_EQ(engine->session_count(), 1u);
+    ASSERT_EQ(cdr->records.size(), 2u);
+}
+
+TEST_F(EngineTest, SessionExpiresByInjectedClock) {
+    uint64_t key = imsi_key_from_string("250990000000001");
+    engine->process(key);
+
+    now += config.session_timeout_sec;
+    ASSERT_EQ(engine->expire_sessions(), 0u);
+    now += 1;
+    ASSERT_EQ(engine->expire_sessions(), 1u);
+    ASSERT_FALSE(engine->is_active(key));
+    ASSERT_EQ(cdr->records.back(), "250990000000001, timeout");
+}
+
+TEST_F(EngineTest, DrainRemovesAtMostRequested) {
+    engine->process(imsi_key_from_string("111"));
+    engine->process(imsi_key_from_string("222"));
+    ASSERT_EQ(engine->drain(1), 1u);
+    ASSERT_EQ(engine->session_count(), 1u);
+    ASSERT_EQ(engine->drain(10), 1u);
+    ASSERT_EQ(engine->session_count(), 0u);
+    ASSERT_NE(cdr->records.back().find(", shutdown"), std::string::npos);
+}
+
+TEST_F(EngineTest, ReloadedTimeoutAppliesToExistingSessions) {
+    uint64_t old_key = imsi_key_from_string("111");
+    uint64_t new_key = imsi_key_from_string("222");
+    engine->process(old_key);
+    now += 10;
+    engine->process(new_key);
+
+    pgw_server_config reloaded = config;
+    reloaded.session_timeout_sec = 5;
+    ASSERT_EQ(engine->config_store().publish(reloaded)->version, 2u);
+    ASSERT_EQ(engine->config()->config.session_timeout_sec, 5u);
+
+    now += 1;
+    ASSERT_EQ(engine->expire_sessions(), 1u);
+    ASSERT_FALSE(engine->is_active(old_key));
+    ASSERT_TRUE(engine->is_active(new_key));
+    now += 5;
+    ASSERT_EQ(engine->expire_sessions(), 1u);
+    ASSERT_EQ(engine->session_count(), 0u);
+}
+
+TEST_F(EngineTest, ReloadedBlacklistAppliesToNextRequest) {
+    uint64_t key = imsi_key_from_string("250990000000001");
+    pgw_server_config reloaded = config;
+    reloaded.blacklist = {"250990000000001", "not-an-imsi"};
+    engine->config_store().publish(reloaded);
+    ASSERT_EQ(engine->process(key), BATCH_STATUS_REJECTED);
+    ASSERT_EQ(engine->process(imsi_key_from_string("001010123456789")), BATCH_STATUS_CREATED);
+    ASSERT_EQ(engine->config_store().current()->blacklist.size(), 1u);
+}
+
+TEST_F(EngineTest, ReplacedConfigIsFreedAfterLastHandle) {
+    ConfigSnapshotPtr held = engine->config();
+    std::weak_ptr<const ConfigSnapshot> first = held;
+    pgw_server_config reloaded = config;
+    reloaded.session_timeout_sec = 5;
+    engine->config_store().publish(reloaded);
+
+    ASSERT_EQ(held->config.session_timeout_sec, config.session_timeout_sec);
+    ASSERT_FALSE(first.expired());
+    held.reset();
+    ASSERT_TRUE(first.expired());
+    ASSERT_EQ(engine->config()->version, 2u);
+}
+
+TEST_F(EngineTest, ExpiryOrdersAdoptedSessionsAndSkipsRemoved) {
+    std::vector<SessionRecord> adopted = {
+        {imsi_key_from_string("111"), now - 5},
+        {imsi_key_from_string("222"), now - 40},
+        {imsi_key_from_string("333"), now - 20},
+    };
+    ASSERT_EQ(engine->adopt_sessions(adopted), 3u);
+    ASSERT_EQ(engine->expire_sessions(), 1u);
+    ASSERT_FALSE(engine->is_active(imsi_key_from_string("222")));
+
+    // Сессия, пересозданная после drain, живёт от нового времени начала
+    ASSERT_EQ(engine->drain(10), 2u);
+    now += 20;
+    engine->process(imsi_key_from_string("333"));
+    ASSERT_EQ(engine->expire_sessions(), 0u);
+    ASSERT_TRUE(engine->is_active(imsi_key_from_string("333")));
+    now += 31;
+    ASSERT_EQ(engine->expire_sessions(), 1u);
+    ASSERT_EQ(engine->session_count(), 0u);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+#include "../src/Utils/utils.h"
+#include "../src/Server/packet_handler.h"
+#include "../src/Server/worker_pool.h"
+#include "../src/Utils/batch_protocol.h"
+#include "trace.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/basic_file_sink.h>
+
+static std::atomic<bool> count_allocations(false);
+static std::atomic<size_t> allocation_count(0);
+
+// malloc/free вызываются вне тел operator new/delete: иначе после встраивания GCC видит free()
+// у указателя из new и предупреждает -Wmismatched-new-delete
+__attribute__((noinline)) static void* counted_alloc(size_t size, size_t alignment) {
+    if (count_allocations) ++allocation_count;
+    size = size ? size : 1;
+    void* ptr = alignment > alignof(std::max_align_t)
+                    ? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+                    : std::malloc(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+__attribute__((noinline)) static void counted_free(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void* operator new(size_t size) { return counted_alloc(size, 0); }
+void* operator new[](size_t size) { return counted_alloc(size, 0); }
+void* operator new(size_t size, std::align_val_t al) { return counted_alloc(size, static_cast<size_t>(al)); }
+void* operator new[](size_t size, std::align_val_t al) { return counted_alloc(size, static_cast<size_t>(al)); }
+
+void operator delete(void* ptr) noexcept { counted_free(ptr); }
+void operator delete[](void* ptr) noexcept { counted_free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { counted_free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { counted_free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { counted_free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { counted_free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { counted_free(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { counted_free(ptr); }
+
+class HotPathTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        config.cdr_file = "./hot_path_cdr.log";
+        config.blacklist = {"001010123456789"};
+        auto file_sink = std::make_shared<spdlog::sinks::basic_file_sink_mt>("./hot_path.log", true);
+        logger = std::make_shared<spdlog::logger>("hot_path_logger", file_sink);
+        logger->set_level(spdlog::level::info);
+        logger->flush_on(spdlog::level::info);
+        auto cdr = std::make_shared<FileCdrSink>();
+        ASSERT_TRUE(cdr->open(config.cdr_file));
+        engine = std::make_unique<PgwEngine>(config, logger, cdr);
+    }
+
+    void TearDown() override {
+        logger->flush();
+        std::remove("./hot_path_cdr.log");
+        std::remove("./hot_path.log");
+    }
+
+    Packet make_packet(const std::string& imsi) {
+        Packet packet;
+        std::vector<uint8_t> bcd = encode_bcd(imsi);
+        memcpy(packet.data, bcd.data(), bcd.size());
+        packet.bytes_received = bcd.size();
+        packet.client_len = sizeof(packet.client_addr);
+        memset(&packet.client_addr, 0, sizeof(packet.client_addr));
+        packet.client_addr.sin_family = AF_INET;
+        packet.client_addr.sin_port = htons(40000);
+        inet_pton(AF_INET, "127.0.0.1", &packet.client_addr.sin_addr);
+        return packet;
+    }
+
+    size_t count_per_packet(const Packet& packet, int iterations) {
+        allocation_count = 0;
+        count_allocations = true;
+        for (int i = 0; i < iterations; ++i) {
+            handle_packet(*engine, packet);
+        }
+        count_allocations = false;
+        return allocation_count;
+    }
+
+    pgw_server_config config;
+    std::shared_ptr<spdlog::logger> logger;
+    std::unique_ptr<PgwEngine> engine;
+};
+
+TEST_F(HotPathTest, KnownIMSIDoesNotAllocate) {
+    Packet packet = make_packet("123456789012345");
+    ASSERT_STREQ(handle_packet(*engine, packet), "created");
+    ASSERT_STREQ(handle_packet(*engine, packet), "created");
+    ASSERT_EQ(count_per_packet(packet, 1000), 0u);
+}
+
+TEST_F(HotPathTest, BlacklistedIMSIDoesNotAllocate) {
+    Packet packet = make_packet("001010123456789");
+    ASSERT_STREQ(handle_packet(*engine, packet), "rejected");
+    ASSERT_EQ(count_per_packet(packet, 1000), 0u);
+}
+
+TEST_F(HotPathTest, KnownBatchDoesNotAllocate) {
+    uint32_t ids[] = {1, 2, 3};
+    uint64_t keys[] = {imsi_key_from_string("123456789012345"), imsi_key_from_string("001010123456789"),
+                       imsi_key_from_string("250990000000002")};
+    Packet packet = make_packet("1");
+    packet.bytes_received = encode_batch_request(9, ids, keys, 3, reinterpret_cast<uint8_t*>(packet.data), BUFFER_SIZE);
+    uint8_t response[BATCH_MAX_RESPONSE_SIZE];
+    ASSERT_GT(handle_batch_packet(*engine, packet, response, sizeof(response)), 0u);
+    ASSERT_EQ(response[BATCH_HEADER_SIZE + 1], BATCH_STATUS_REJECTED);
+
+    allocation_count = 0;
+    count_allocations = true;
+    for (int i = 0; i < 1000; ++i) {
+        handle_batch_packet(*engine, packet, response, sizeof(response));
+    }
+    count_allocations = false;
+    ASSERT_EQ(allocation_count.load(), 0u);
+}
+
+TEST_F(HotPathTest, TracedPacketDoesNotAllocate) {
+    Packet packet = make_packet("123456789012345");
+    TraceScope trace(1);
+    ASSERT_STREQ(handle_packet(*engine, packet), "created");
+    ASSERT_EQ(count_per_packet(packet, 1000), 0u);
+}
+
+TEST_F(HotPathTest, QueuePushPopDoesNotAllocate) {
+    PacketQueue queue(QUEUE_CAPACITY);
+    Packet packet = make_packet("123456789012345");
+    Packet out;
+    allocation_count = 0;
+    count_allocations = true;
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(queue.push(packet));
+        ASSERT_TRUE(queue.pop(out));
+    }
+    count_allocations = false;
+    ASSERT_EQ(allocation_count.load(), 0u);
+}
+
+// Весь путь рабочего потока, как в сервере: очередь пула, обработка и отправка ответа
+TEST_F(HotPathTest, WorkerPoolAndSendDoNotAllocate) {
+    int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+    Packet packet = make_packet("123456789012345");
+    packet.client_addr.sin_port = 0;
+    ASSERT_EQ(bind(receiver, (struct sockaddr*)&packet.client_addr, sizeof(packet.client_addr)), 0);
+    getsockname(receiver, (struct sockaddr*)&packet.client_addr, &packet.client_len);
+    int sender = socket(AF_INET, SOCK_DGRAM, 0);
+
+    std::atomic<int> sent(0);
+    WorkerPoolOptions options;
+    options.min_workers = 2;
+    options.max_workers = 2;
+    WorkerPool pool(options, [&](const Packet& p) {
+        const char* response = handle_packet(*engine, p);
+        if (sendto(sender, response, strlen(response), 0, (const struct sockaddr*)&p.client_addr, p.client_len) > 0) {
+            ++sent;
+        }
+    }, nullptr);
+    pool.start();
+    ASSERT_TRUE(pool.submit(packet));
+    while (sent.load() < 1) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    char reply[16] = {};
+    ASSERT_GT(recv(receiver, reply, sizeof(reply) - 1, 0), 0);
+    ASSERT_STREQ(reply, "created");
+
+    allocation_count = 0;
+    count_allocations = true;
+    for (int i = 0; i < 1000; ++i) {
+        while (!pool.submit(packet)) std::this_thread::yield();
+        if (i % 100 == 0) {
+            while (sent.load() < i + 1) std::this_thread::yield();
+            recv(receiver, reply, sizeof(reply), MSG_DONTWAIT);
+        }
+    }
+    while (sent.load() < 1001) std::this_thread::yield();
+    count_allocations = false;
+    pool.stop();
+    close(sender);
+    close(receiver);
+    ASSERT_EQ(allocation_count.load(), 0u);
+}
+
+TEST_F(HotPathTest, AllocationHookIsActive) {
+    Packet packet = make_packet("250990000000001");
+    allocation_count = 0;
+    count_allocations = true;
+    handle_packet(*engine, packet);
+    count_allocations = false;
+    ASSERT_GT(allocation_count.load(), 0u);
+}
+
+TEST_F(HotPathTest, InvalidBCDIsRejected) {
+    Packet packet = make_packet("123");
+    packet.data[0] = static_cast<char>(0xAB);
+    ASSERT_STREQ(handle_packet(*engine, packet), "rejected");
+    ASSERT_EQ(engine->session_count(), 0u);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+#include "shm_channel.h"
+#include "shm_producer.h"
+#include "utils.h"
+#include <atomic>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ShmTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        name = "/pgw_test_" + std::to_string(getpid());
+    }
+
+    void TearDown() override {
+        stop_consumer();
+        channel.destroy();
+    }
+
+    // Потребитель отвечает статусом request_id % 3
+    void start_consumer(int idle_timeout_ms = 20) {
+        running = true;
+        consumer = std::thread([this, idle_timeout_ms] {
+            uint32_t slots[16];
+            while (running) {
+                size_t count = channel.poll(slots, 16);
+                if (count == 0) {
+                    channel.wait_for_work(idle_timeout_ms);
+                    continue;
+                }
+                for (size_t i = 0; i < count; ++i) {
+                    channel.complete(slots[i], channel.slot(slots[i]).request_id % 3);
+                }
+            }
+        });
+    }
+
+    void stop_consumer() {
+        running = false;
+        if (consumer.joinable()) consumer.join();
+    }
+
+    std::string name;
+    ShmChannel channel;
+    std::thread consumer;
+    std::atomic<bool> running{false};
+};
+
+TEST_F(ShmTest, ConnectFailsWithoutChannel) {
+    ShmProducer producer;
+    ASSERT_FALSE(producer.connect(name));
+}
+
+TEST_F(ShmTest, RejectsNonPowerOfTwoCapacity) {
+    ASSERT_FALSE(channel.create(name, 100));
+}
+
+TEST_F(ShmTest, ConnectRejectsCorruptCapacity) {
+    ASSERT_TRUE(channel.create(name, 64));
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    ASSERT_GE(fd, 0);
+    void* region = mmap(nullptr, sizeof(ShmHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    ASSERT_NE(region, MAP_FAILED);
+    ShmHeader* header = static_cast<ShmHeader*>(region);
+
+    ShmProducer producer;
+    header->capacity = 0;
+    EXPECT_FALSE(producer.connect(name));
+    header->capacity = 48;
+    EXPECT_FALSE(producer.connect(name));
+    header->capacity = 64;
+    EXPECT_TRUE(producer.connect(name));
+    munmap(region, sizeof(ShmHeader));
+}
+
+TEST_F(ShmTest, PollDropsCellWithForeignSlot) {
+    ASSERT_TRUE(channel.create(name, 4));
+    ShmProducer producer;
+    ASSERT_TRUE(producer.connect(name));
+    std::vector<uint8_t> bcd = encode_bcd("250990000000001");
+    uint32_t slot;
+    ASSERT_TRUE(producer.submit(bcd.data(), bcd.size(), 1, slot));
+
+    // Продюсер портит опубликованную ячейку и ёмкость в заголовке
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    ASSERT_GE(fd, 0);
+    size_t size = shm_region_size(4);
+    void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    ASSERT_NE(region, MAP_FAILED);
+    ShmHeader* header = static_cast<ShmHeader*>(region);
+    shm_cells(header)[0].slot = 1000;
+    header->capacity = 1u << 30;
+
+    uint32_t polled[4];
+    EXPECT_EQ(channel.poll(polled, 4), 0u);
+    EXPECT_EQ(channel.rejected(), 1u);
+    EXPECT_EQ(channel.capacity(), 4u);
+
+    // Канал продолжает работать с ёмкостью из create()
+    ASSERT_TRUE(producer.submit(bcd.data(), bcd.size(), 2, slot));
+    ASSERT_EQ(channel.poll(polled, 4), 1u);
+    EXPECT_EQ(polled[0], slot);
+    EXPECT_EQ(channel.slot(slot).request_id, 2u);
+    munmap(region, size);
+}
+
+TEST_F(ShmTest, RequestRoundTrip) {
+    ASSERT_TRUE(channel.create(name, 8));
+    start_consumer();
+    ShmProducer producer;
+    ASSERT_TRUE(producer.connect(name));
+
+    std::vector<uint8_t> bcd = encode_bcd("250990000000001");
+    for (uint32_t id = 1; id <= 100; ++id) {
+        uint32_t slot;
+        uint8_t status = 0xFF;
+        ASSERT_TRUE(producer.submit(bcd.data(), bcd.size(), id, slot));
+        ASSERT_TRUE(producer.wait(slot, 1000, status));
+        ASSERT_EQ(status, id % 3);
+    }
+}
+
+TEST_F(ShmTest, SlotCarriesPaddedBCD) {
+    ASSERT_TRUE(channel.create(name, 2));
+    ShmProducer producer;
+    ASSERT_TRUE(producer.connect(name));
+    std::vector<uint8_t> bcd = encode_bcd("12345");
+    uint32_t slot;
+    ASSERT_TRUE(producer.submit(bcd.data(), bcd.size(), 7, slot));
+
+    uint32_t polled[2];
+    ASSERT_EQ(channel.poll(polled, 2), 1u);
+    ASSERT_EQ(polled[0], slot);
+    ASSERT_EQ(imsi_key_from_bcd(channel.slot(slot).bcd, SHM_BCD_SIZE), imsi_key_from_string("12345"));
+}
+
+TEST_F(ShmTest, ConcurrentProducers) {
+    ASSERT_TRUE(channel.create(name, 16));
+    start_consumer();
+
+    std::atomic<int> failures{0};
+    std::vector<std::thread> producers;
+    for (int t = 0; t < 4; ++t) {
+        producers.emplace_back([&, t] {
+            ShmProducer producer;
+            if (!producer.connect(name)) {
+                ++failures;
+                return;
+            }
+            std::vector<uint8_t> bcd = encode_bcd("00101000000000" + std::to_string(t));
+            for (uint32_t id = 0; id < 500; ++id) {
+                uint32_t slot;
+                uint8_t status;
+                while (!producer.submit(bcd.data(), bcd.size(), id, slot)) std::this_thread::yield();
+                if (!producer.wait(slot, 2000, status) || status != id % 3) ++failures;
+            }
+        });
+    }
+    for (auto& p : producers) p.join();
+    ASSERT_EQ(failures.load(), 0);
+}
+
+TEST_F(ShmTest, SleepingConsumerIsWoken) {
+    ASSERT_TRUE(channel.create(name, 4));
+    start_consumer(2000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    ShmProducer producer;
+    ASSERT_TRUE(producer.connect(name));
+    std::vector<uint8_t> bcd = encode_bcd("123");
+    uint8_t status;
+    auto start = std::chrono::steady_clock::now();
+    uint32_t slot;
+    ASSERT_TRUE(producer.submit(bcd.data(), bcd.size(), 4, slot));
+    ASSERT_TRUE(producer.wait(slot, 1000, status));
+    ASSERT_EQ(status, 1);
+    ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(500));
+}
+
+TEST_F(ShmTest, TimedOutSlotIsReleasedByConsumer) {
+    ASSERT_TRUE(channel.create(name, 2));
+    ShmProducer producer;
+    ASSERT_TRUE(producer.connect(name));
+    std::vector<uint8_t> bcd = encode_bcd("123");
+
+    uint32_t slot;
+    uint8_t status;
+    ASSERT_TRUE(producer.submit(bcd.data(), bcd.size(), 1, slot));
+    ASSERT_FALSE(producer.wait(slot, 20, status));
+    uint32_t other;
+    ASSERT_TRUE(producer.submit(bcd.data(), bcd.size(), 2, other));
+    ASSERT_FALSE(producer.submit(bcd.data(), bcd.size(), 3, other));
+
+    start_consumer();
+    ASSERT_TRUE(producer.wait(other, 1000, status));
+    ASSERT_TRUE(producer.submit(bcd.data(), bcd.size(), 3, other));
+    ASSERT_TRUE(producer.submit(bcd.data(), bcd.size(), 4, slot));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
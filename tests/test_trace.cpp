@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include "trace.h"
+#include "pgw_engine.h"
+#include "utils.h"
+#include <atomic>
+#include <nlohmann/json.hpp>
+#include <set>
+#include <string>
+#include <thread>
+
+// События трассы с заданным идентификатором из дампа всех потоков
+static std::vector<nlohmann::json> events_for(uint64_t trace_id) {
+    std::vector<nlohmann::json> result;
+    nlohmann::json trace = nlohmann::json::parse(trace_dump_chrome_json());
+    for (const auto& event : trace["traceEvents"]) {
+        if (event["args"]["packet"].get<uint64_t>() == trace_id) result.push_back(event);
+    }
+    return result;
+}
+
+TEST(TraceTest, SamplingOffRecordsNothing) {
+    trace_set_sample_rate(0);
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_EQ(trace_sample(), 0u);
+    }
+    {
+        TraceScope trace(trace_sample());
+        TraceSpan span(TRACE_STAGE_PACKET);
+    }
+    EXPECT_TRUE(events_for(0).empty());
+}
+
+TEST(TraceTest, SampleRateSelectsEveryNth) {
+    trace_set_sample_rate(4);
+    std::set<uint64_t> ids;
+    for (int i = 0; i < 40; ++i) {
+        uint64_t id = trace_sample();
+        if (id) ids.insert(id);
+    }
+    trace_set_sample_rate(0);
+    EXPECT_EQ(ids.size(), 10u);
+}
+
+TEST(TraceTest, SpansAppearInChromeTrace) {
+    const uint64_t id = 1000001;
+    {
+        TraceScope trace(id);
+        TraceSpan packet_span(TRACE_STAGE_PACKET);
+        TraceSpan parse_span(TRACE_STAGE_PARSE);
+        parse_span.finish();
+    }
+    TraceSpan outside(TRACE_STAGE_SEND);
+    outside.finish();
+
+    auto events = events_for(id);
+    ASSERT_EQ(events.size(), 2u);
+    EXPECT_EQ(events[0]["name"], "parse");
+    EXPECT_EQ(events[1]["name"], "packet");
+    EXPECT_EQ(events[1]["ph"], "X");
+    EXPECT_LE(events[1]["ts"].get<double>(), events[0]["ts"].get<double>());
+    EXPECT_GE(events[1]["dur"].get<double>(), events[0]["dur"].get<double>());
+}
+
+TEST(TraceTest, RingKeepsLatestEvents) {
+    const uint64_t base = 2000000;
+    std::thread writer([&] {
+        for (uint64_t i = 0; i < TRACE_RING_CAPACITY + 10; ++i) {
+            trace_record(base + i, TRACE_STAGE_CDR, 100, 200);
+        }
+    });
+    writer.join();
+
+    nlohmann::json trace = nlohmann::json::parse(trace_dump_chrome_json());
+    size_t count = 0;
+    uint64_t oldest = UINT64_MAX;
+    for (const auto& event : trace["traceEvents"]) {
+        uint64_t id = event["args"]["packet"].get<uint64_t>();
+        if (id < base || id >= base + TRACE_RING_CAPACITY + 10) continue;
+        ++count;
+        oldest = std::min(oldest, id);
+    }
+    EXPECT_EQ(count, static_cast<size_t>(TRACE_RING_CAPACITY));
+    EXPECT_EQ(oldest, base + 10);
+}
+
+TEST(TraceTest, DumpDuringWritesHasNoTornEvents) {
+    // Поля события связаны с идентификатором: смешанное или недописанное событие нарушит связь
+    const uint64_t base = 3000000;
+    std::atomic<bool> done(false);
+    std::thread writer([&] {
+        for (uint64_t i = 0; !done; ++i) {
+            uint64_t id = base + i % 1000000;
+            trace_record(id, static_cast<TraceStage>(id % TRACE_STAGE_COUNT), id * 1000, id * 3000);
+        }
+    });
+    size_t checked = 0;
+    for (int round = 0; round < 10; ++round) {
+        nlohmann::json trace = nlohmann::json::parse(trace_dump_chrome_json());
+        for (const auto& event : trace["traceEvents"]) {
+            uint64_t id = event["args"]["packet"].get<uint64_t>();
+            if (id < base || id >= base + 1000000) continue;
+            ASSERT_EQ(event["ts"].get<double>(), id * 1000 / 1000.0);
+            ASSERT_EQ(event["dur"].get<double>(), id * 2000 / 1000.0);
+            ASSERT_EQ(event["name"].get<std::string>(), trace_stage_name(static_cast<TraceStage>(id % TRACE_STAGE_COUNT)));
+            ++checked;
+        }
+    }
+    done = true;
+    writer.join();
+    EXPECT_GT(checked, 0u);
+}
+
+TEST(TraceTest, EngineRecordsStages) {
+    pgw_server_config config;
+    config.session_timeout_sec = 30;
+    PgwEngine engine(config, nullptr, nullptr);
+
+    const uint64_t id = 3000001;
+    {
+        TraceScope trace(id);
+        engine.process(imsi_key_from_string("250990000000001"), "test");
+    }
+    std::set<std::string> names;
+    for (const auto& event : events_for(id)) names.insert(event["name"].get<std::string>());
+    EXPECT_EQ(names, (std::set<std::string>{"log", "session_lock_wait", "session_update", "cdr"}));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include "../src/Utils/utils.h"
 #include "../src/Configs/pgw_client_config.h"
+#include "../src/Utils/batch_protocol.h"
 #include <vector>
 #include <string>
 #include <fstream>
@@ -43,6 +44,80 @@ TEST(BCDTest, DecodeEmptyBCD) {
     ASSERT_EQ(result, expected);
 }
 
+TEST(IMSIKeyTest, StringAndBCDKeysMatch) {
+    std::vector<uint8_t> bcd = encode_bcd("001010123456789");
+    uint64_t key = imsi_key_from_bcd(bcd.data(), bcd.size());
+    ASSERT_NE(key, IMSI_KEY_INVALID);
+    ASSERT_EQ(key, imsi_key_from_string("001010123456789"));
+    ASSERT_NE(key, imsi_key_from_string("00101012345678"));
+}
+
+TEST(IMSIKeyTest, KeyToDigits) {
+    char digits[IMSI_MAX_DIGITS + 1];
+    size_t len = imsi_key_to_digits(imsi_key_from_string("0012345678"), digits);
+    ASSERT_EQ(std::string(digits, len), "0012345678");
+}
+
+TEST(IMSIKeyTest, InvalidIMSI) {
+    ASSERT_EQ(imsi_key_from_string(""), IMSI_KEY_INVALID);
+    ASSERT_EQ(imsi_key_from_string("1234567890123456"), IMSI_KEY_INVALID);
+    ASSERT_EQ(imsi_key_from_string("12a4"), IMSI_KEY_INVALID);
+    uint8_t bad[] = {0x21, 0xA3};
+    ASSERT_EQ(imsi_key_from_bcd(bad, sizeof(bad)), IMSI_KEY_INVALID);
+}
+
+TEST(BatchProtocolTest, RequestRoundTrip) {
+    uint32_t ids[] = {7, 42};
+    uint64_t keys[] = {imsi_key_from_string("001010123456789"), imsi_key_from_string("250991234")};
+    uint8_t buffer[BATCH_MAX_REQUEST_SIZE];
+    size_t len = encode_batch_request(0xDEADBEEF, ids, keys, 2, buffer, sizeof(buffer));
+    ASSERT_EQ(len, BATCH_HEADER_SIZE + 2 * BATCH_ENTRY_SIZE);
+    ASSERT_TRUE(is_batch_datagram(buffer, len));
+
+    BatchRequestView view;
+    ASSERT_EQ(view.parse(buffer, len), BATCH_PARSE_OK);
+    ASSERT_EQ(view.batch_id(), 0xDEADBEEF);
+    ASSERT_EQ(view.count(), 2u);
+    ASSERT_EQ(view.request_id(1), 42u);
+    ASSERT_EQ(imsi_key_from_bcd(view.bcd(0), IMSI_BCD_MAX_BYTES), keys[0]);
+    ASSERT_EQ(imsi_key_from_bcd(view.bcd(1), IMSI_BCD_MAX_BYTES), keys[1]);
+}
+
+TEST(BatchProtocolTest, RejectsLengthMismatch) {
+    uint32_t ids[] = {1, 2};
+    uint64_t keys[] = {imsi_key_from_string("123"), imsi_key_from_string("456")};
+    uint8_t buffer[BATCH_MAX_REQUEST_SIZE];
+    size_t len = encode_batch_request(1, ids, keys, 2, buffer, sizeof(buffer));
+    BatchRequestView view;
+    ASSERT_EQ(view.parse(buffer, len - 1), BATCH_PARSE_TRUNCATED);
+    ASSERT_EQ(view.parse(buffer, BATCH_HEADER_SIZE - 1), BATCH_PARSE_TRUNCATED);
+    buffer[9] = 3;
+    ASSERT_EQ(view.parse(buffer, len), BATCH_PARSE_TRUNCATED);
+    buffer[9] = 0;
+    ASSERT_EQ(view.parse(buffer, BATCH_HEADER_SIZE), BATCH_PARSE_BAD_COUNT);
+    buffer[1] = BATCH_VERSION + 1;
+    ASSERT_EQ(view.parse(buffer, len), BATCH_PARSE_BAD_VERSION);
+}
+
+TEST(BatchProtocolTest, LegacyDatagramIsNotBatch) {
+    std::vector<uint8_t> bcd = encode_bcd("001010123456789");
+    ASSERT_FALSE(is_batch_datagram(bcd.data(), bcd.size()));
+}
+
+TEST(BatchProtocolTest, ResponseRoundTrip) {
+    uint8_t statuses[] = {BATCH_STATUS_CREATED, BATCH_STATUS_REJECTED, BATCH_STATUS_INVALID};
+    uint8_t buffer[BATCH_MAX_RESPONSE_SIZE];
+    size_t len = encode_batch_response(5, statuses, 3, buffer, sizeof(buffer));
+    uint32_t batch_id = 0;
+    const uint8_t* parsed = nullptr;
+    size_t count = 0;
+    ASSERT_EQ(parse_batch_response(buffer, len, batch_id, parsed, count), BATCH_PARSE_OK);
+    ASSERT_EQ(batch_id, 5u);
+    ASSERT_EQ(count, 3u);
+    ASSERT_EQ(parsed, buffer + BATCH_HEADER_SIZE);
+    ASSERT_STREQ(batch_status_name(parsed[1]), "rejected");
+}
+
 TEST(BlacklistTest, CheckBlacklistedIMSI) {
     pgw_server_config config;
     config.blacklist = {"001010123456789", "001010000000001"};
@@ -103,10 +178,33 @@ TEST(ClientConfigTest, LoadValidConfig) {
     ASSERT_EQ(config.server_port, 9009);
     ASSERT_EQ(config.log_file, "./client.log");
     ASSERT_EQ(config.log_level, "info");
+    ASSERT_EQ(config.max_retries, 3u);
 
     std::remove(config_file.c_str());
 }
 
+TEST(ClientConfigTest, MaxRetriesIsConfigurable) {
+    std::string config_file = "./test_config.json";
+    std::ofstream out(config_file);
+    out << R"({
+        "server_ip": "127.0.0.1",
+        "server_port": 9009,
+        "log_file": "./client.log",
+        "log_level": "info",
+        "max_retries": 0
+    })";
+    out.close();
+
+    pgw_client_config config = load_pgw_client_config(config_file);
+    ASSERT_EQ(config.max_retries, 0u);
+    ASSERT_TRUE(validate_pgw_client_config(config));
+    config.max_retries = 11;
+    ASSERT_FALSE(validate_pgw_client_config(config));
+
+    std::remove(config_file.c_str());
+    std::remove("./client.log");
+}
+
 TEST(ClientConfigTest, LoadInvalidConfig) {
     std::string config_file = "./test_config.json";
     std::string log_file = "./test_error.log";
@@ -137,6 +235,47 @@ TEST(ClientConfigTest, LoadInvalidConfig) {
     std::remove(log_file.c_str());
 }
 
+TEST(ServerConfigTest, ClusterWithoutNodeIdIsRejected) {
+    std::string config_file = "./test_server_config.json";
+    auto write_config = [&](const std::string& cluster) {
+        std::ofstream out(config_file);
+        out << R"({
+            "udp_ip": "127.0.0.1",
+            "udp_port": 9000,
+            "session_timeout_sec": 30,
+            "cdr_file": "./test_cdr.log",
+            "http_port": 8080,
+            "graceful_shutdown_rate": 10,
+            "log_file": "./test_server.log",
+            "log_level": "info",
+            "blacklist": [],
+            "cluster": )" << cluster << "}";
+    };
+
+    write_config(R"({"nodes": [{"id": "a", "ip": "127.0.0.1", "port": 9100}]})");
+    pgw_server_config config = load_pgw_server_config(config_file);
+    EXPECT_TRUE(config.udp_ip.empty());
+    EXPECT_FALSE(validate_pgw_server_config(config));
+
+    write_config(R"({"node_id": "a", "nodes": [{"ip": "127.0.0.1", "port": 9100}]})");
+    config = load_pgw_server_config(config_file);
+    EXPECT_TRUE(config.cluster_nodes.empty());
+    EXPECT_FALSE(validate_pgw_server_config(config));
+
+    write_config(R"({"node_id": "a"})");
+    EXPECT_TRUE(load_pgw_server_config(config_file).cluster_node_id.empty());
+
+    write_config(R"({"node_id": "a", "nodes": [{"id": "a", "ip": "127.0.0.1", "port": 9100}]})");
+    config = load_pgw_server_config(config_file);
+    EXPECT_EQ(config.cluster_node_id, "a");
+    ASSERT_EQ(config.cluster_nodes.size(), 1u);
+    EXPECT_TRUE(validate_pgw_server_config(config));
+
+    std::remove(config_file.c_str());
+    std::remove("./test_cdr.log");
+    std::remove("./test_server.log");
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,240 @@
+#include <gtest/gtest.h>
+#include "../src/Server/worker_pool.h"
+#include "trace.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static Packet make_packet(int id) {
+    Packet packet;
+    memset(&packet.client_addr, 0, sizeof(packet.client_addr));
+    packet.client_len = sizeof(packet.client_addr);
+    memcpy(packet.data, &id, sizeof(id));
+    packet.bytes_received = sizeof(id);
+    packet.received_ns = trace_now_ns();
+    return packet;
+}
+
+static int packet_id(const Packet& packet) {
+    int id;
+    memcpy(&id, packet.data, sizeof(id));
+    return id;
+}
+
+template <typename Predicate>
+static bool wait_until(Predicate predicate, std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!predicate()) {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+TEST(WorkerPoolTest, ProcessesAllPackets) {
+    const int total = 20000;
+    std::vector<std::atomic<int>> seen(total);
+    std::atomic<int> processed(0);
+    WorkerPoolOptions options;
+    options.min_workers = 4;
+    options.max_workers = 4;
+    WorkerPool pool(options, [&](const Packet& packet) {
+        ++seen[packet_id(packet)];
+        ++processed;
+    }, nullptr);
+    pool.start();
+
+    for (int i = 0; i < total; ++i) {
+        while (!pool.submit(make_packet(i))) std::this_thread::yield();
+    }
+    ASSERT_TRUE(wait_until([&] { return processed.load() == total; }));
+    pool.stop();
+
+    for (int i = 0; i < total; ++i) EXPECT_EQ(seen[i].load(), 1) << i;
+    uint64_t counted = 0;
+    for (const auto& worker : pool.stats()) counted += worker.processed;
+    EXPECT_EQ(counted, static_cast<uint64_t>(total));
+}
+
+TEST(WorkerPoolTest, BurstFitsAtMinimumSize) {
+    for (size_t min_workers : {1, 2, 3, 8}) {
+        std::atomic<bool> release(false);
+        std::atomic<size_t> processed(0);
+        WorkerPoolOptions options;
+        options.min_workers = min_workers;
+        options.max_workers = 8;
+        options.scale_interval_ms = 60000; // пул не успевает вырасти во время всплеска
+        WorkerPool pool(options, [&](const Packet&) {
+            while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ++processed;
+        }, nullptr);
+        pool.start();
+        EXPECT_GE(pool.queue_capacity() * min_workers, static_cast<size_t>(QUEUE_TOTAL_CAPACITY));
+
+        // Все потоки заблокированы обработкой, весь всплеск остаётся в очередях
+        size_t dropped = 0;
+        for (int i = 0; i < QUEUE_TOTAL_CAPACITY; ++i) {
+            if (!pool.submit(make_packet(i))) ++dropped;
+        }
+        EXPECT_EQ(dropped, 0u) << "min_workers = " << min_workers;
+        release = true;
+        ASSERT_TRUE(wait_until([&] { return processed.load() == QUEUE_TOTAL_CAPACITY; }));
+        pool.stop();
+    }
+}
+
+TEST(WorkerPoolTest, IdleWorkerStealsFromBlockedOne) {
+    std::mutex mutex;
+    std::vector<int> order;
+    std::atomic<bool> release(false);
+    WorkerPoolOptions options;
+    options.min_workers = 2;
+    options.max_workers = 2;
+    WorkerPool pool(options, [&](const Packet& packet) {
+        int id = packet_id(packet);
+        if (id == 0) {
+            while (!release) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        order.push_back(id);
+    }, nullptr);
+    pool.start();
+
+    // Пакеты раскладываются по кругу: чётные попадают в очередь потока, занятого пакетом 0
+    for (int i = 0; i < 100; ++i) ASSERT_TRUE(pool.submit(make_packet(i)));
+    ASSERT_TRUE(wait_until([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        return order.size() == 99;
+    }));
+    release = true;
+    ASSERT_TRUE(wait_until([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        return order.size() == 100;
+    }));
+    pool.stop();
+
+    EXPECT_EQ(order.back(), 0);
+    uint64_t stolen = 0;
+    for (const auto& worker : pool.stats()) stolen += worker.stolen;
+    EXPECT_GT(stolen, 0u);
+}
+
+TEST(WorkerPoolTest, GrowsUnderLoadAndShrinksWhenIdle) {
+    std::atomic<bool> slow(true);
+    std::atomic<int> processed(0);
+    WorkerPoolOptions options;
+    options.min_workers = 1;
+    options.max_workers = 4;
+    options.scale_interval_ms = 10;
+    options.shrink_ticks = 3;
+    WorkerPool pool(options, [&](const Packet&) {
+        if (slow) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        ++processed;
+    }, nullptr);
+    pool.start();
+    EXPECT_EQ(pool.active_workers(), 1u);
+
+    int submitted = 0;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (pool.active_workers() < 4 && std::chrono::steady_clock::now() < deadline) {
+        if (pool.submit(make_packet(submitted))) ++submitted;
+        else std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    EXPECT_EQ(pool.active_workers(), 4u);
+
+    slow = false;
+    ASSERT_TRUE(wait_until([&] { return processed.load() == submitted; }));
+    EXPECT_TRUE(wait_until([&] { return pool.active_workers() == 1; }));
+
+    // Остановленный поток запускается снова
+    slow = true;
+    EXPECT_TRUE(wait_until([&] {
+        if (pool.submit(make_packet(submitted))) ++submitted;
+        return pool.active_workers() > 1;
+    }));
+    slow = false;
+    pool.stop();
+}
+
+TEST(WorkerPoolTest, StatsCoverAllSlots) {
+    WorkerPoolOptions options;
+    options.min_workers = 2;
+    options.max_workers = 5;
+    WorkerPool pool(options, [](const Packet&) {}, nullptr);
+    pool.start();
+    auto stats = pool.stats();
+    ASSERT_EQ(stats.size(), 5u);
+    for (size_t i = 0; i < stats.size(); ++i) {
+        EXPECT_EQ(stats[i].id, i);
+        EXPECT_EQ(stats[i].active, i < 2);
+        EXPECT_EQ(stats[i].queue_depth, 0u);
+        EXPECT_GE(stats[i].utilization, 0.0);
+        EXPECT_LE(stats[i].utilization, 1.0);
+    }
+    pool.stop();
+    EXPECT_EQ(pool.active_workers(), 0u);
+}
+
+TEST(WorkerPoolTest, SetLimitsResizesRunningPool) {
+    WorkerPoolOptions options;
+    options.min_workers = 1;
+    options.max_workers = 4;
+    WorkerPool pool(options, [](const Packet&) {}, nullptr);
+    pool.start();
+    pool.set_limits(3, 6);
+    EXPECT_EQ(pool.active_workers(), 3u);
+    EXPECT_EQ(pool.min_workers(), 3u);
+    EXPECT_EQ(pool.max_workers(), 4u); // слотов больше, чем при создании, не появляется
+    pool.set_limits(1, 2);
+    EXPECT_EQ(pool.active_workers(), 2u);
+    pool.stop();
+}
+
+TEST(WorkerPoolTest, RetiringWorkerExitsUnderSustainedLoad) {
+    std::atomic<bool> feeding(true);
+    std::atomic<int> processed(0);
+    WorkerPoolOptions options;
+    options.min_workers = 2;
+    options.max_workers = 2;
+    options.scale_interval_ms = 10;
+    WorkerPool pool(options, [&](const Packet&) {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        ++processed;
+    }, nullptr);
+    pool.start();
+
+    // Поток приёма не даёт очередям опустеть: прежде остановленный поток крал работу и не выходил
+    std::thread feeder([&] {
+        int id = 0;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (feeding && std::chrono::steady_clock::now() < deadline) {
+            if (pool.submit(make_packet(id))) ++id;
+            else std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    });
+    ASSERT_TRUE(wait_until([&] { return processed.load() > 100; }));
+
+    auto started = std::chrono::steady_clock::now();
+    for (int i = 0; i < 5; ++i) {
+        pool.set_limits(1, 1);
+        pool.set_limits(2, 2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        EXPECT_EQ(pool.stats().size(), 2u);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - started;
+    EXPECT_TRUE(feeding.load());
+    EXPECT_LT(elapsed, std::chrono::seconds(2));
+    EXPECT_EQ(pool.active_workers(), 2u);
+
+    feeding = false;
+    feeder.join();
+    pool.stop();
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}